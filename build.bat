@@ -9,6 +9,7 @@ cd build
 g++ -std=c++17 ^
     -I../include ^
     ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
     ../src/gameplay.cpp ^
     ../test/interface.cpp ^
     ../test/main.cpp ^
@@ -21,4 +22,131 @@ if %errorlevel% equ 0 (
     echo Build failed!
 )
 
+:: Compile the level solver
+g++ -std=c++17 -O2 -pthread ^
+    -I../include ^
+    ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
+    ../src/gameplay.cpp ^
+    ../src/solver.cpp ^
+    ../src/transposition_table.cpp ^
+    ../tools/solve.cpp ^
+    -lpsapi ^
+    -o solve.exe
+
+if %errorlevel% equ 0 (
+    echo Solver built: solve.exe ..\levels\l1.json
+) else (
+    echo Solver build failed!
+)
+
+:: Compile the headless replay player
+g++ -std=c++17 -O2 ^
+    -I../include ^
+    ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
+    ../src/gameplay.cpp ^
+    ../src/replay.cpp ^
+    ../tools/replay.cpp ^
+    -o replay.exe
+
+if %errorlevel% equ 0 (
+    echo Replay player built: replay.exe ..\..\replays\*.ppr
+) else (
+    echo Replay player build failed!
+)
+
+:: Compile the model benchmark
+g++ -std=c++17 -O2 -pthread ^
+    -I../include ^
+    ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
+    ../src/gameplay.cpp ^
+    ../src/batch_simulator.cpp ^
+    ../tools/bench.cpp ^
+    -o bench.exe
+
+if %errorlevel% equ 0 (
+    echo Benchmark built: bench.exe ..\levels\l1.json ..\levels\l2.json --json
+) else (
+    echo Benchmark build failed!
+)
+
+:: Compile the level generator
+g++ -std=c++17 -O2 -pthread ^
+    -I../include ^
+    ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
+    ../src/gameplay.cpp ^
+    ../src/solver.cpp ^
+    ../src/transposition_table.cpp ^
+    ../src/level_generator.cpp ^
+    ../tools/generate.cpp ^
+    -lpsapi ^
+    -o generate.exe
+
+if %errorlevel% equ 0 (
+    echo Level generator built: generate.exe --count 10 --out ..\levels
+) else (
+    echo Level generator build failed!
+)
+
+:: Compile the level analytics tool
+g++ -std=c++17 -O2 -pthread ^
+    -I../include ^
+    ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
+    ../src/gameplay.cpp ^
+    ../tools/analyze.cpp ^
+    -o analyze.exe
+
+if %errorlevel% equ 0 (
+    echo Level analytics built: analyze.exe ..\levels
+) else (
+    echo Level analytics build failed!
+)
+
+:: Compile the level compiler (JSON to binary .ppl)
+g++ -std=c++17 -O2 ^
+    -I../include ^
+    ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
+    ../tools/compile_levels.cpp ^
+    -o compile_levels.exe
+
+if %errorlevel% equ 0 (
+    echo Level compiler built: compile_levels.exe --check ..\levels
+) else (
+    echo Level compiler build failed!
+)
+
+:: Compile the asset packer
+g++ -std=c++17 -O2 ^
+    -I../include ^
+    ../src/asset_archive.cpp ^
+    ../tools/pack_assets.cpp ^
+    -o pack_assets.exe
+
+if %errorlevel% equ 0 (
+    echo Asset packer built: pack_assets.exe --check view/shader view/assest resource model/levels (run in the game directory)
+) else (
+    echo Asset packer build failed!
+)
+
+:: Compile the C interface (parabox_env.h) as a shared library
+g++ -std=c++17 -O2 -pthread -shared -DPARABOX_BUILD ^
+    -I../include ^
+    ../src/level_loader.cpp ^
+    ../src/asset_archive.cpp ^
+    ../src/gameplay.cpp ^
+    ../src/batch_simulator.cpp ^
+    ../src/parabox_env.cpp ^
+    -o parabox.dll
+
+if %errorlevel% equ 0 (
+    echo C interface built: parabox.dll
+) else (
+    echo C interface build failed!
+)
+
 cd ..
@@ -1,10 +1,19 @@
 ﻿#include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <array>
+#include <ctime>
+#include <filesystem>
 #include <iostream>
 
 #include "view/game_view.hpp"
 #include "viewmodel/game_view_model.hpp"
+#include "viewmodel/save_service.hpp"
+#include "model/include/replay.hpp"
+#include "model/include/asset_archive.hpp"
+
+// Autosave written whenever the state changes and resumed at the next start.
+static const char* const AUTOSAVE_PATH = "saves/autosave.pps";
 
 // GameApplication orchestrates window management, rendering, and gameplay state.
 // Mirrors the lifecycle of a typical game loop: init -> run -> shutdown.
@@ -25,6 +34,18 @@ private:
     void update();
     // Clear buffers and ask the view to render either UI or gameplay scene.
     void render();
+    // Append an accepted action to the session replay, stamped with the current frame time.
+    void recordReplay(ReplayAction action, int value);
+    // Write the session replay to replays/ (skipped if nothing was recorded).
+    void saveReplay();
+    // Start recording a new replay; the game must be at the level's initial state.
+    void startReplay();
+    // Hand a copy of the session to the background writer; returns at once.
+    void submitSave(const std::string& path);
+    // Resume a saved session (level, state, undo journal and camera).
+    bool resumeSave(const SavedSession& session);
+    // Path of the selected quick-save slot.
+    std::string quickSavePath() const;
 
     // Raw mouse events forwarded to the view (camera orbit or UI hover).
     void onMouseMove(double xpos, double ypos);
@@ -48,15 +69,30 @@ private:
     double lastInputTime_ = 0.0;       // Timestamp of last processed input (throttling).
     const double inputCooldown_ = 0.2; // Minimum time between accepted inputs.
     bool winAnnounced_ = false;        // Tracks whether win message was printed.
+    int announcedTargets_ = -1;        // Last reported number of uncovered box targets.
+    bool deadlockAnnounced_ = false;   // Tracks whether the "stuck" prompt was printed.
+    uint64_t announcedHintVersion_ = 0; // State version whose hint was last printed (0 = none).
     bool gameStarted_ = false;         // Gated until the Start button is clicked.
+    Replay replay_;                    // Actions of this session, saved on exit for headless playback.
+    double replayStartTime_ = 0.0;     // Frame time that replay timestamps are relative to.
+    bool recordingReplay_ = true;      // Off while playing on from a resumed save, until the level is restarted.
+
+    SaveService saves_;                // Writes autosaves and quick saves on its own thread.
+    uint64_t autosavedVersion_ = 0;    // State version last handed to the autosave.
+    int quickSlot_ = 1;                // Quick-save slot used by F5 / F9, chosen with keys 1-4.
 
-    GameState cachedState_{};          // Local copy of game state used for rendering.
-    GameState cachedNextState_{};
-    bool hasCachedState_ = false;      // Whether cachedState_ currently holds a valid snapshot.
+    GameViewModel::StateSnapshot renderState_{}; // State rendered, refreshed only when the state version changes.
+    bool animateFromPrevious_ = false; // Whether the move animation starts from renderState_.previous (false: blocked move played in place).
 
     // 键盘去抖：记录上一帧的按键状态
     bool lastKeyUPressed_ = false;
     bool lastKeyIPressed_ = false;
+    bool lastKeyZPressed_ = false;
+    bool lastKeyYPressed_ = false;
+    bool lastKeyRPressed_ = false;
+    bool lastKeyHPressed_ = false;
+    bool lastKeyF5Pressed_ = false;
+    bool lastKeyF9Pressed_ = false;
 
     // 位移动画时序
     bool animatingMove_ = false;
@@ -66,6 +102,15 @@ private:
     // 动画末段输入缓存
     bool hasPendingInput_ = false;
     Input pendingInput_ = UP;
+
+    // 执行一次移动（已按相机重映射）并启动其动画；被阻挡的移动只原地播放
+    void startMove(Input input, double now);
+
+    // 四个方向的移动预览（按 Input 索引），状态变化时才重新计算
+    void refreshMovePreviews();
+    std::array<std::vector<MoveEvent>, 4> movePreviews_;
+    std::array<bool, 4> canMove_{};
+    uint64_t previewVersion_ = ~0ull;
 };
 
 GameApplication::GameApplication(int width, int height)
@@ -86,6 +131,18 @@ bool GameApplication::init() {
         return false;
     }
 
+    // Shaders, textures, models and levels come from one memory-mapped archive when it is found
+    // next to the executable or above the working directory; otherwise from the loose files.
+    std::string archive = Assets::findArchive();
+    if (!archive.empty()) {
+        try {
+            Assets::mount(archive);
+            std::cout << "Assets: " << archive << std::endl;
+        } catch (const std::exception& ex) {
+            std::cerr << ex.what() << "; reading loose asset files instead." << std::endl;
+        }
+    }
+
     view_.init(windowWidth_, windowHeight_);
     view_.setGameSceneVisible(false);
     view_.setStartCallback([this]() {
@@ -102,6 +159,22 @@ bool GameApplication::init() {
     view_.registerPortals(viewModel_.getState(), viewModel_.getLevel());
 
     lastFrameTime_ = glfwGetTime();
+    startReplay();
+    autosavedVersion_ = viewModel_.stateVersion();
+
+    // 继续上次未完成的关卡（已通关或未走动的自动存档不恢复）
+    std::error_code error;
+    if (viewModel_.hasGame() && std::filesystem::exists(AUTOSAVE_PATH, error)) {
+        try {
+            SavedSession last = SessionFile::load(AUTOSAVE_PATH);
+            const GameSession& game = last.game;
+            if (game.position > 0 && !game.state.is_win && resumeSave(last)) {
+                std::cout << "Resumed your last game (" << game.position << " moves)." << std::endl;
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "Ignoring autosave: " << ex.what() << std::endl;
+        }
+    }
     return true;
 }
 
@@ -157,6 +230,12 @@ void GameApplication::run() {
         glfwSwapBuffers(window_);
         glfwPollEvents();
     }
+
+    saveReplay();
+    if (viewModel_.hasGame() && gameStarted_) {
+        submitSave(AUTOSAVE_PATH);
+    }
+    saves_.flush();
 }
 
 void GameApplication::processInput() {
@@ -187,6 +266,72 @@ void GameApplication::processInput() {
         return u >= 0.8; // 末段判定阈值：80% 以后（略微增大以避免经常性的误触发）
     };
 
+    // 撤销 / 重做 / 重开：边沿触发，动画与相机旋转期间忽略，执行后直接跳到新状态（无位移动画）
+    auto keyPressedOnce = [&](int key, bool& lastPressed) {
+        bool pressed = glfwGetKey(window_, key) == GLFW_PRESS;
+        bool triggered = pressed && !lastPressed;
+        lastPressed = pressed;
+        return triggered;
+    };
+    bool undoKey = keyPressedOnce(GLFW_KEY_Z, lastKeyZPressed_);
+    bool redoKey = keyPressedOnce(GLFW_KEY_Y, lastKeyYPressed_);
+    bool restartKey = keyPressedOnce(GLFW_KEY_R, lastKeyRPressed_);
+    if (keyPressedOnce(GLFW_KEY_H, lastKeyHPressed_)) {
+        viewModel_.setHintsEnabled(!viewModel_.hintsEnabled());
+        announcedHintVersion_ = 0;
+        std::cout << (viewModel_.hintsEnabled() ? "Hints on" : "Hints off") << std::endl;
+    }
+    // 快速存档：1-4 选择槽位，F5 保存（后台写盘），F9 读取
+    for (int slot = 1; slot <= 4; ++slot) {
+        if (glfwGetKey(window_, GLFW_KEY_0 + slot) == GLFW_PRESS && quickSlot_ != slot) {
+            quickSlot_ = slot;
+            std::cout << "Quick-save slot " << slot << std::endl;
+        }
+    }
+    bool quickSaveKey = keyPressedOnce(GLFW_KEY_F5, lastKeyF5Pressed_);
+    bool quickLoadKey = keyPressedOnce(GLFW_KEY_F9, lastKeyF9Pressed_);
+    if ((quickSaveKey || quickLoadKey) && !animatingMove_ && !view_.isCameraRotating()) {
+        if (quickSaveKey) {
+            submitSave(quickSavePath());
+            std::cout << "Saved to slot " << quickSlot_ << std::endl;
+        } else {
+            // 先等待尚未写完的存档（例如刚按下的 F5），再同步读取；存档只有几 KB，远小于一帧
+            saves_.flush();
+            try {
+                if (resumeSave(SessionFile::load(quickSavePath()))) {
+                    std::cout << "Loaded slot " << quickSlot_ << std::endl;
+                }
+            } catch (const std::exception& ex) {
+                std::cerr << ex.what() << std::endl;
+            }
+        }
+        lastInputTime_ = now;
+        return;
+    }
+
+    if ((undoKey || redoKey || restartKey) && !animatingMove_ && !view_.isCameraRotating()) {
+        if (undoKey) {
+            if (viewModel_.undo()) {
+                recordReplay(REPLAY_UNDO, 0);
+            }
+        } else if (redoKey) {
+            if (viewModel_.redo()) {
+                recordReplay(REPLAY_REDO, 0);
+            }
+        } else {
+            if (viewModel_.rewind(viewModel_.moveCount()) > 0) {
+                if (recordingReplay_) {
+                    recordReplay(REPLAY_RESTART, 0);
+                } else {
+                    startReplay();   // 从读档处重开后回到关卡初始状态，重新开始录像
+                }
+            }
+        }
+        hasPendingInput_ = false;
+        lastInputTime_ = now;
+        return;
+    }
+
     Input input = UP;
     int viewRotate = GLFW_KEY_U;
     bool hasInput = false;
@@ -257,42 +402,142 @@ void GameApplication::processInput() {
         }
 
         // 以相机为参考系重映射输入
-        input = view_.remapInputForCamera(input);
-
-        // 应用输入前缓存“前状态”
-        GameState prev = viewModel_.getState();
-
-        // 执行一次操作
-        viewModel_.handleInput(input);
-
-        // 输入后读取“目标状态”
-        GameState next = viewModel_.getState();
-
-        // 缓存状态用于渲染插值
-        cachedState_ = prev;
-        cachedNextState_ = next;
-        hasCachedState_ = true;
-
-        // 启动动画
-        animatingMove_ = true;
-        moveAnimStart_ = now;
-        view_.beginMoveAnimation(static_cast<float>(moveAnimDuration_), input);
-
-        lastInputTime_ = now;
+        startMove(view_.remapInputForCamera(input), now);
     } else {
         bool wasRotating = view_.isCameraRotating();
         view_.handleKey(viewRotate);
         bool nowRotating = view_.isCameraRotating();
         if (!wasRotating && nowRotating) {
             lastInputTime_ = now;
+            recordReplay(REPLAY_ROTATE_CAMERA, viewRotate == GLFW_KEY_I ? 1 : 0);
         }
     }
 }
 
+void GameApplication::recordReplay(ReplayAction action, int value) {
+    if (!recordingReplay_) {
+        return;
+    }
+    uint32_t timeMs = static_cast<uint32_t>((glfwGetTime() - replayStartTime_) * 1000.0);
+    replay_.events.push_back(ReplayEvent{timeMs, action, static_cast<uint8_t>(value)});
+}
+
+void GameApplication::startReplay() {
+    replay_.level = viewModel_.levelPath();
+    replay_.start_hash = viewModel_.startHash();
+    replay_.events.clear();
+    replayStartTime_ = glfwGetTime();
+    recordingReplay_ = true;
+}
+
+void GameApplication::saveReplay() {
+    if (replay_.events.empty() || !viewModel_.hasGame()) {
+        return;
+    }
+    replay_.end_hash = viewModel_.getState().hash;
+
+    // 以时间戳命名，避免覆盖之前的录像
+    char stamp[32];
+    std::time_t t = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &t);
+#else
+    localtime_r(&t, &local);
+#endif
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+    std::filesystem::path path = std::filesystem::path("replays") / (std::string("replay_") + stamp + ".ppr");
+    try {
+        std::filesystem::create_directories(path.parent_path());
+        ReplayFile::save(path.string(), replay_);
+        std::cout << "Replay saved to " << path.string() << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << "Failed to save replay: " << ex.what() << std::endl;
+    }
+}
+
+void GameApplication::submitSave(const std::string& path) {
+    // 仅在锁内拷贝状态与撤销日志（复用缓冲区），写盘由后台线程完成
+    float yaw = view_.cameraYaw();
+    saves_.submit(path, [&](SavedSession& session) {
+        viewModel_.saveSession(session);
+        session.camera_yaw = yaw;
+    });
+}
+
+bool GameApplication::resumeSave(const SavedSession& session) {
+    // 录像须从关卡初始状态开始：读档前先保存已录制的部分，之后暂停录制，直到重开关卡
+    if (recordingReplay_) {
+        saveReplay();
+        replay_.events.clear();
+        recordingReplay_ = false;
+    }
+
+    std::string previousLevel = viewModel_.levelPath();
+    if (!viewModel_.resumeSession(session)) {
+        if (viewModel_.moveCount() == 0) {
+            startReplay();
+        }
+        return false;
+    }
+    if (viewModel_.levelPath() != previousLevel) {
+        view_.switchLevel();
+        view_.registerPortals(viewModel_.getState(), viewModel_.getLevel());
+    }
+    view_.setCameraYaw(session.camera_yaw);
+
+    // 直接跳到读取的状态，不播放动画
+    animatingMove_ = false;
+    animateFromPrevious_ = false;
+    hasPendingInput_ = false;
+
+    // 存档停在关卡初始状态时可直接开始新的录像
+    if (viewModel_.moveCount() == 0) {
+        startReplay();
+    }
+    return true;
+}
+
+std::string GameApplication::quickSavePath() const {
+    return std::string("saves/quick") + std::to_string(quickSlot_) + ".pps";
+}
+
+void GameApplication::startMove(Input input, double now) {
+    animatingMove_ = true;
+    moveAnimStart_ = now;
+    lastInputTime_ = now;
+
+    // 预览显示该方向被阻挡：状态不会改变，省去操作与状态拷贝，仅播放原地动画
+    refreshMovePreviews();
+    if (!canMove_[input]) {
+        view_.beginMoveAnimation(static_cast<float>(moveAnimDuration_), input, movePreviews_[input]);
+        animateFromPrevious_ = false;
+        return;
+    }
+
+    // 执行一次操作；ViewModel 保留移动前的状态，渲染时从其插值到新状态（无需拷贝）
+    viewModel_.handleInput(input);
+    recordReplay(REPLAY_MOVE, input);
+    animateFromPrevious_ = true;
+    view_.beginMoveAnimation(static_cast<float>(moveAnimDuration_), input, viewModel_.getMoveEvents());
+}
+
+void GameApplication::refreshMovePreviews() {
+    if (previewVersion_ == viewModel_.stateVersion()) {
+        return;
+    }
+    for (int dir = UP; dir <= RIGHT; ++dir) {
+        canMove_[dir] = viewModel_.previewMove(static_cast<Input>(dir), movePreviews_[dir]);
+    }
+    previewVersion_ = viewModel_.stateVersion();
+}
+
 void GameApplication::update() {
     // Maintain bookkeeping flags (win announcements) separate from rendering to keep run loop tidy.
     if (!gameStarted_) {
         winAnnounced_ = false;
+        announcedTargets_ = -1;
+        deadlockAnnounced_ = false;
         return;
     }
 
@@ -300,6 +545,44 @@ void GameApplication::update() {
     viewModel_.update();
 
     if (viewModel_.hasGame()) {
+        // 每帧预先计算四个相邻结果（仅在状态变化后真正求解）
+        refreshMovePreviews();
+
+        // 自动存档：状态变化后交给后台线程写盘，游戏循环不等待文件 I/O
+        if (autosavedVersion_ != viewModel_.stateVersion()) {
+            autosavedVersion_ = viewModel_.stateVersion();
+            submitSave(AUTOSAVE_PATH);
+        }
+
+        int targets = viewModel_.targetsRemaining();
+        if (targets != announcedTargets_) {
+            std::cout << "Targets remaining: " << targets << std::endl;
+            announcedTargets_ = targets;
+        }
+
+        // 提示：后台求解完成后轮询结果（无锁），按当前相机朝向换算成按键
+        HintService::Hint hint = viewModel_.hint();
+        if (hint.status != HintService::HINT_PENDING && announcedHintVersion_ != viewModel_.stateVersion()) {
+            announcedHintVersion_ = viewModel_.stateVersion();
+            if (hint.status == HintService::HINT_MOVE) {
+                static const char* keys[4] = {"W", "S", "A", "D"};
+                for (int key = UP; key <= RIGHT; ++key) {
+                    if (view_.remapInputForCamera(static_cast<Input>(key)) == hint.move) {
+                        std::cout << "Hint: press " << keys[key] << std::endl;
+                        break;
+                    }
+                }
+            } else if (hint.status == HintService::HINT_UNSOLVABLE) {
+                std::cout << "Hint: no solution from here. Press Z to undo or R to restart." << std::endl;
+            }
+        }
+
+        bool deadlocked = viewModel_.isDeadlocked();
+        if (deadlocked && !deadlockAnnounced_) {
+            std::cout << "You're stuck: this level can no longer be won. Press Z to undo or R to restart." << std::endl;
+        }
+        deadlockAnnounced_ = deadlocked;
+
         bool isWin = viewModel_.isWin();
         if (isWin && !winAnnounced_) {
             std::cout << "You won the level!" << std::endl;
@@ -309,6 +592,7 @@ void GameApplication::update() {
         }
     } else {
         winAnnounced_ = false;
+        deadlockAnnounced_ = false;
     }
 }
 
@@ -323,51 +607,32 @@ void GameApplication::render() {
 
     const Level* level = viewModel_.getLevel();
     if (viewModel_.hasGame() && level) {
-        if (!animatingMove_) {
-            // 动画未进行：正常刷新
-            cachedState_ = viewModel_.getState();
-            cachedNextState_ = viewModel_.getNextState();
-            hasCachedState_ = true;
-        } else {
+        if (animatingMove_) {
             // 动画期间：检查结束
             double now = glfwGetTime();
             if (now - moveAnimStart_ >= moveAnimDuration_) {
                 animatingMove_ = false;
 
-                // 若存在缓存输入，则立即执行并触发下一段动画
+                // 若存在缓存输入，则立即执行并触发下一段动画（与直接输入相同，被阻挡时原地播放）
                 if (hasPendingInput_) {
                     hasPendingInput_ = false;
-
-                    GameState prev = viewModel_.getState();
-                    // 执行缓存输入
-                    viewModel_.handleInput(pendingInput_);
-                    GameState next = viewModel_.getState();
-
-                    cachedState_ = prev;
-                    cachedNextState_ = next;
-                    hasCachedState_ = true;
-
-                    // 立即启动下一段动画
-                    animatingMove_ = true;
-                    moveAnimStart_ = now;
-                    view_.beginMoveAnimation(static_cast<float>(moveAnimDuration_), pendingInput_);
-                    lastInputTime_ = now;
-                } else {
-                    // 无缓存输入：刷新到最新状态
-                    cachedState_ = viewModel_.getState();
-                    cachedNextState_ = viewModel_.getNextState();
-                    hasCachedState_ = true;
+                    startMove(pendingInput_, now);
                 }
             }
         }
 
-        if (hasCachedState_) {
-            view_.render(&cachedState_, level, &cachedNextState_);
+        // 仅在状态版本变化时重新取快照；快照只含指针，每帧不拷贝、不分配状态
+        if (renderState_.version != viewModel_.stateVersion()) {
+            renderState_ = viewModel_.snapshot();
+        }
+        if (renderState_.current) {
+            // 移动动画从移动前的状态插值到当前状态；其余时候两者相同
+            const GameState* from = animatingMove_ && animateFromPrevious_ ? renderState_.previous : renderState_.current;
+            view_.render(from, level);
         } else {
             view_.render(nullptr, nullptr);
         }
     } else {
-        hasCachedState_ = false;
         view_.render(nullptr, nullptr);
     }
 }
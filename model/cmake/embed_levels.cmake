@@ -0,0 +1,40 @@
+# Writes OUTPUT, the table of built-in levels parsed at compile time by src/embedded_levels.cpp,
+# from the level files of LEVEL_DIR named in LEVEL_DIR/campaign.txt. The CMake build runs it into its
+# build tree whenever the list or one of its files changes; refresh the copy in src/, used by builds
+# without CMake, with:
+#   cmake -DLEVEL_DIR=levels -DOUTPUT=src/embedded_level_data.inc -P cmake/embed_levels.cmake
+
+get_filename_component(LEVEL_DIR "${LEVEL_DIR}" ABSOLUTE)
+file(STRINGS "${LEVEL_DIR}/campaign.txt" lines)
+set(level_files "")
+foreach(line IN LISTS lines)
+    string(STRIP "${line}" name)
+    if(name STREQUAL "" OR name MATCHES "^#")
+        continue()
+    endif()
+    if(NOT EXISTS "${LEVEL_DIR}/${name}")
+        message(FATAL_ERROR "campaign.txt names ${name}, which is not in ${LEVEL_DIR}")
+    endif()
+    list(APPEND level_files "${name}")
+endforeach()
+list(LENGTH level_files level_count)
+
+set(content "// Generated by cmake/embed_levels.cmake from the levels/*.json named in levels/campaign.txt; do not edit.\n")
+string(APPEND content "// Refresh with: cmake -DLEVEL_DIR=levels -DOUTPUT=src/embedded_level_data.inc -P cmake/embed_levels.cmake\n\n")
+string(APPEND content "constexpr std::array<EmbeddedSource, ${level_count}> EMBEDDED_LEVEL_SOURCES = {{\n")
+foreach(name IN LISTS level_files)
+    file(READ "${LEVEL_DIR}/${name}" text)
+    string(LENGTH "${text}" length)
+    # MSVC rejects longer string literals
+    if(length GREATER 16000)
+        message(FATAL_ERROR "${name} is too large to embed (${length} bytes)")
+    endif()
+    string(FIND "${text}" ")parabox_json" clash)
+    if(NOT clash EQUAL -1)
+        message(FATAL_ERROR "${name} contains the raw string delimiter )parabox_json")
+    endif()
+    string(APPEND content "    {\"${name}\", R\"parabox_json(${text})parabox_json\"},\n")
+endforeach()
+string(APPEND content "}};\n")
+
+file(WRITE "${OUTPUT}" "${content}")
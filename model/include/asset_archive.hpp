@@ -0,0 +1,137 @@
+#ifndef ASSET_ARCHIVE_HPP
+#define ASSET_ARCHIVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class MappedFile;
+
+/// @brief Contents of an asset, read without copying
+/// @details Points either into a mounted archive or into a mapping of a loose file, and keeps
+///          that mapping alive for as long as any copy of the object exists.
+class AssetData
+{
+public:
+    /// @brief An asset that was not found
+    AssetData() = default;
+
+    /// @brief The bytes [data, data + size) of a mapping owned by file
+    AssetData(std::shared_ptr<const MappedFile> file, const uint8_t* data, size_t size)
+        : file(std::move(file)), bytes(data), length(size), found(true)
+    {
+    }
+
+    /// @brief Whether the asset was found
+    explicit operator bool() const { return found; }
+
+    /// @brief First byte of the asset, nullptr if it is empty or was not found
+    const uint8_t* data() const { return bytes; }
+
+    /// @brief Size of the asset in bytes
+    size_t size() const { return length; }
+
+    /// @brief The asset as text (not null-terminated)
+    std::string_view text() const { return {reinterpret_cast<const char*>(bytes), length}; }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool found = false;
+};
+
+/// @brief A file to store in an asset archive
+struct AssetSource
+{
+    std::string name;    ///< Path the asset is looked up by, e.g. "view/shader/pbr.vert"
+    std::string path;    ///< File to read its contents from
+};
+
+/// @brief Read-only archive of asset files (.ppak), memory-mapped as a whole
+/// @details A table of contents sorted by name, followed by the contents of every file,
+///          each starting at a multiple of ALIGNMENT. Lookups binary-search the table and
+///          return views into the mapping.
+class AssetArchive
+{
+public:
+    /// @brief Version of the archive format written by pack()
+    static constexpr uint32_t VERSION = 1;
+
+    /// @brief Alignment of every asset's contents within the file
+    static constexpr size_t ALIGNMENT = 64;
+
+    AssetArchive() = default;
+
+    /// @brief Map an archive and read its table of contents, replacing any archive already open
+    /// @throws std::runtime_error if the file cannot be mapped or is not a valid archive of VERSION
+    void open(const std::string& path);
+
+    /// @brief Whether an archive is open
+    bool isOpen() const { return file != nullptr; }
+
+    /// @brief Contents of the asset stored under a path, not found if there is none
+    /// @param name Path of the asset, compared after normalize()
+    AssetData find(std::string_view name) const;
+
+    /// @brief Names of all assets, sorted
+    std::vector<std::string> names() const;
+
+    /// @brief Write an archive of the given files
+    /// @throws std::runtime_error if two sources share a name, a file cannot be read or the archive cannot be written
+    static void pack(std::vector<AssetSource> sources, const std::string& path);
+
+    /// @brief The name an asset path is stored and looked up under
+    /// @details Forward slashes, no "./" components and no repeated slashes: "view\\shader/./pbr.vert"
+    ///          and "./view/shader/pbr.vert" both become "view/shader/pbr.vert".
+    static std::string normalize(std::string_view path);
+
+private:
+    struct Entry
+    {
+        std::string_view name;    ///< Points into the mapping
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::shared_ptr<const MappedFile> file;
+    std::vector<Entry> entries;    ///< Sorted by name
+};
+
+/// @brief Virtual file system through which the game reads its shaders, textures, models and levels
+/// @details A path is looked up in the mounted archive first. If it is not stored there, the loose
+///          file is mapped: relative to the working directory, then relative to the directory of the
+///          archive. Mount the archive before other threads start reading assets.
+namespace Assets {
+
+/// @brief File name of the archive the game looks for, see findArchive()
+inline constexpr const char* DEFAULT_ARCHIVE = "assets.ppak";
+
+/// @brief Mount an asset archive, replacing the mounted one
+/// @details Data read from the previous archive stays valid.
+/// @throws std::runtime_error if the file cannot be mapped or is not a valid archive
+void mount(const std::string& archive_path);
+
+/// @brief Stop reading from the mounted archive
+void unmount();
+
+/// @brief Whether an archive is mounted
+bool isMounted();
+
+/// @brief Locate an archive: next to the executable, then in the working directory and each of its parents
+/// @return Path of the first one found, empty if there is none
+std::string findArchive(const std::string& name = DEFAULT_ARCHIVE);
+
+/// @brief Contents of an asset, from the mounted archive or the loose file; not found if neither exists
+AssetData read(const std::string& path);
+
+/// @brief Whether read() would find an asset
+bool exists(const std::string& path);
+
+} // namespace Assets
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef BATCH_SIMULATOR_HPP
+#define BATCH_SIMULATOR_HPP
+
+#include "gameplay.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+class WorkStealingPool;
+
+/// @brief Many independent games of one level, stepped together
+/// @details Instances are stored structure-of-arrays. Objects are numbered player first,
+///          then boxes by id, then box rooms by id. Each object has an array of level-wide
+///          cell indices (see cellPos()), one per instance. Hashes, remaining targets, win
+///          flags and moved flags are arrays too. Each instance also keeps an occupancy grid
+///          of object numbers, so that pushes resolve without searching.
+///          Moves are resolved by resolvePush(), the rules GamePlay::operate() uses, and hashes
+///          match GameState::hash. The undo journal, portal_just_passed and deadlock detection
+///          are not kept; load state() into a GamePlay for those.
+class BatchSimulator
+{
+public:
+    /// @brief Create 'instances' games of a level, all in its initial state
+    /// @param level The level to play
+    /// @param instances Number of games
+    /// @param threads Threads used by step() (0 = one per hardware thread)
+    BatchSimulator(const Level& level, size_t instances, int threads = 0);
+    ~BatchSimulator();
+
+    BatchSimulator(const BatchSimulator&) = delete;
+    BatchSimulator& operator=(const BatchSimulator&) = delete;
+
+    /// @brief Number of games
+    size_t size() const { return count; }
+
+    /// @brief Number of objects per game (player, boxes and box rooms)
+    int objectCount() const { return static_cast<int>(objects.size()); }
+
+    /// @brief Kind and id of an object number
+    Occupant objectOccupant(int object) const { return objects[object]; }
+
+    /// @brief Position of a level-wide cell index
+    Pos cellPos(int cell) const { return cellPositions[cell]; }
+
+    /// @brief Put every game back into the level's initial state
+    void reset();
+
+    /// @brief Put one game back into the level's initial state
+    void reset(size_t instance);
+
+    /// @brief Make one move in every game
+    /// @details Games are split into chunks spread over the worker threads.
+    /// @param inputs size() moves, one per game
+    void step(const Input* inputs);
+
+    /// @brief Cells of an object in every game (size() entries)
+    const int32_t* objectCells(int object) const { return positions.data() + static_cast<size_t>(object) * count; }
+
+    /// @brief GameState::hash of every game
+    const uint64_t* hashes() const { return hashValues.data(); }
+
+    /// @brief GameState::targets_remaining of every game
+    const int32_t* targetsRemaining() const { return targetCounts.data(); }
+
+    /// @brief GameState::is_win of every game, 0 or 1
+    const uint8_t* wins() const { return winFlags.data(); }
+
+    /// @brief Per game: 1 if its last step displaced anything, 0 if the move was blocked
+    const uint8_t* moved() const { return movedFlags.data(); }
+
+    /// @brief State of one game as a GameState
+    /// @details Player, boxes, box rooms, hash, targets_remaining and is_win are filled in.
+    GameState state(size_t instance) const;
+
+private:
+    /// @brief Scratch storage of one worker thread
+    struct alignas(64) Worker
+    {
+        PushScratch scratch;
+        std::vector<MoveEvent> events;
+    };
+
+    /// @brief One game seen through the world interface of resolvePush()
+    struct InstanceView;
+
+    static constexpr size_t CHUNK = 256;    ///< Games per task of the thread pool
+    static constexpr int32_t STEP_WALL = -1;      ///< neighbours: the move runs into a wall
+    static constexpr int32_t STEP_PORTAL = -2;    ///< neighbours: the move may leave through a box room entry
+
+    size_t count;                              ///< Number of games
+    std::vector<Room> rooms;                   ///< Rooms of the level
+    std::vector<int> roomOffsets;              ///< Index of each room's first cell in the level-wide numbering
+    std::vector<Pos> cellPositions;            ///< Per level-wide cell: its position
+    int cells = 0;                             ///< Cells of all rooms
+    std::vector<uint8_t> wallCells;            ///< Per cell: 1 if walls or portal walls block it
+    std::vector<uint8_t> boxTargetCells;       ///< Per cell: 1 if it is a box target
+    std::vector<int32_t> neighbours;           ///< Per (cell, direction): the plain neighbouring cell, or STEP_*
+    int playerTarget = -1;                     ///< Cell the player has to reach
+
+    std::vector<Occupant> objects;             ///< Per object number: its kind and id
+    std::vector<int> boxroomObjects;           ///< Per room: object number of its placed box room, -1 if none
+    std::vector<uint64_t> keys;                ///< Per (object, cell): Zobrist key
+    std::vector<int32_t> initialCells;         ///< Per object: cell in the initial state
+    uint64_t initialHash = 0;
+    int32_t initialTargets = 0;
+    uint8_t initialWin = 0;
+
+    std::vector<int32_t> positions;            ///< Per (object, game): cell, object-major
+    std::vector<uint16_t> occupancy;           ///< Per (game, cell): object number + 1, 0 if free
+    std::vector<uint64_t> hashValues;          ///< Per game
+    std::vector<int32_t> targetCounts;         ///< Per game
+    std::vector<uint8_t> winFlags;             ///< Per game
+    std::vector<uint8_t> movedFlags;           ///< Per game
+
+    std::unique_ptr<WorkStealingPool> pool;
+    std::vector<Worker> workers;               ///< One per pool thread
+
+    int cellOf(Pos pos) const { return roomOffsets[pos.room] + pos.y * rooms[pos.room].size + pos.x; }
+    int objectOf(Occupant object) const;
+    void stepInstance(Worker& worker, size_t instance, Input input);
+};
+
+#endif
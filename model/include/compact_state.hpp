@@ -0,0 +1,292 @@
+#ifndef COMPACT_STATE_HPP
+#define COMPACT_STATE_HPP
+
+#include "gameplay.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+/// @brief Maximum number of rooms in a level (box rooms are named by a single digit)
+constexpr int COMPACT_MAX_ROOMS = 10;
+
+/// @brief Fold a 64-bit value into a running hash (splitmix64 finalizer)
+inline uint64_t mixHash(uint64_t hash, uint64_t value)
+{
+    uint64_t z = hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/// @brief Occupancy bitboard of one room whose side is at most N
+/// @details Cell (x, y) maps to bit y * N + x. The generic version spans several 64-bit words.
+template <int N, bool Small = (N <= 8)>
+struct RoomBitboard
+{
+    static constexpr int WORDS = (N * N + 63) / 64;
+    std::array<uint64_t, WORDS> words{};
+
+    bool test(int x, int y) const { int i = y * N + x; return (words[i >> 6] >> (i & 63)) & 1; }
+    void set(int x, int y) { int i = y * N + x; words[i >> 6] |= uint64_t(1) << (i & 63); }
+    void clear(int x, int y) { int i = y * N + x; words[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+    bool empty() const { return std::all_of(words.begin(), words.end(), [](uint64_t w) { return w == 0; }); }
+    bool operator== (const RoomBitboard& other) const { return words == other.words; }
+    uint64_t hash(uint64_t seed) const
+    {
+        for (uint64_t word: words) {
+            seed = mixHash(seed, word);
+        }
+        return seed;
+    }
+};
+
+/// @brief Occupancy bitboard of a room of side at most 8, held in a single word
+template <int N>
+struct RoomBitboard<N, true>
+{
+    uint64_t bits = 0;
+
+    bool test(int x, int y) const { return (bits >> (y * N + x)) & 1; }
+    void set(int x, int y) { bits |= uint64_t(1) << (y * N + x); }
+    void clear(int x, int y) { bits &= ~(uint64_t(1) << (y * N + x)); }
+    bool empty() const { return bits == 0; }
+    bool operator== (const RoomBitboard& other) const { return bits == other.bits; }
+    uint64_t hash(uint64_t seed) const { return mixHash(seed, bits); }
+};
+
+/// @brief Compact, fixed-size game state for levels whose rooms all fit in N x N and number at most R
+/// @details Boxes are stored as per-room occupancy bitboards (boxes are interchangeable, so their
+///          ids are dropped), box rooms and the player as packed positions. The state is trivially
+///          copyable: copying or comparing it costs a few machine words, which is what search and
+///          batch simulation need. Transient fields of GameState (portal_just_passed, is_win) are
+///          not part of it.
+template <int N, int R>
+struct CompactState
+{
+    static_assert(N > 0 && R > 0 && R <= COMPACT_MAX_ROOMS, "invalid CompactState dimensions");
+
+    /// @brief Packed position: room * N * N + y * N + x (16 bits when all R rooms fit below NOWHERE)
+    using PackedPos = std::conditional_t<(R * N * N < 0xFFFF), uint16_t, uint32_t>;
+    static constexpr PackedPos NOWHERE = static_cast<PackedPos>(-1);   ///< A box room not placed in any room
+
+    std::array<RoomBitboard<N>, R> boxes{};   ///< Box occupancy of each room
+    std::array<PackedPos, R> boxrooms{};      ///< Position of each box room (by room id), or NOWHERE
+    PackedPos player = 0;                     ///< Position of the player
+
+    /// @brief Whether a level with the given rooms can be represented
+    static bool fits(const std::vector<Room>& rooms)
+    {
+        if (rooms.size() > R) {
+            return false;
+        }
+        for (const auto& room: rooms) {
+            if (room.size > N) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static PackedPos packPos(Pos pos) { return static_cast<PackedPos>(pos.room * N * N + pos.y * N + pos.x); }
+    static Pos unpackPos(PackedPos packed) { return {packed / (N * N), packed % N, (packed / N) % N}; }
+
+    /// @brief Build the compact form of a game state
+    static CompactState pack(const GameState& state)
+    {
+        CompactState compact;
+        compact.boxrooms.fill(NOWHERE);
+        compact.player = packPos(state.player);
+        for (const auto& [bid, box]: state.boxes) {
+            compact.boxes[box.room].set(box.x, box.y);
+        }
+        for (const auto& [rid, boxroom]: state.boxrooms) {
+            compact.boxrooms[rid] = packPos(boxroom);
+        }
+        return compact;
+    }
+
+    /// @brief Expand to a GameState
+    /// @details Box ids are reassigned in room, row, column order, the same order GamePlay uses
+    ///          when it reads a level, so a packed initial state unpacks to the original ids.
+    GameState unpack() const
+    {
+        GameState state;
+        state.player = unpackPos(player);
+        state.portal_just_passed = std::nullopt;
+        state.is_win = false;
+        int boxid = 0;
+        for (int room = 0; room < R; ++room) {
+            if (boxes[room].empty()) {
+                continue;
+            }
+            for (int y = 0; y < N; ++y) {
+                for (int x = 0; x < N; ++x) {
+                    if (boxes[room].test(x, y)) {
+                        state.boxes[boxid++] = {room, x, y};
+                    }
+                }
+            }
+        }
+        for (int rid = 0; rid < R; ++rid) {
+            if (boxrooms[rid] != NOWHERE) {
+                state.boxrooms[rid] = unpackPos(boxrooms[rid]);
+            }
+        }
+        return state;
+    }
+
+    bool operator== (const CompactState& other) const
+    {
+        return player == other.player && boxrooms == other.boxrooms && boxes == other.boxes;
+    }
+    bool operator!= (const CompactState& other) const { return !(*this == other); }
+
+    uint64_t hash() const
+    {
+        uint64_t h = mixHash(0, player);
+        for (int room = 0; room < R; ++room) {
+            h = boxes[room].hash(mixHash(h, boxrooms[room]));
+        }
+        return h;
+    }
+};
+
+/// @brief Compact game state for levels with rooms too large for a fixed-size bitboard
+/// @details Positions are packed into level-wide cell indices; boxes are kept as a sorted list,
+///          so memory scales with the number of boxes instead of the room area.
+struct DynamicCompactState
+{
+    static constexpr uint32_t NOWHERE = 0xFFFFFFFF;
+
+    std::vector<uint32_t> boxes;      ///< Sorted packed box positions
+    std::vector<uint32_t> boxrooms;   ///< Packed position of each box room (by room id), or NOWHERE
+    uint32_t player = 0;              ///< Packed position of the player
+
+    /// @brief Level-wide cell numbering shared by all dynamic states of a level
+    struct Layout
+    {
+        std::vector<uint32_t> offsets;   ///< First cell index of each room
+        std::vector<int> sizes;          ///< Side of each room
+
+        explicit Layout(const std::vector<Room>& rooms)
+        {
+            uint32_t total = 0;
+            for (const auto& room: rooms) {
+                offsets.push_back(total);
+                sizes.push_back(room.size);
+                total += room.size * room.size;
+            }
+        }
+
+        uint32_t packPos(Pos pos) const { return offsets[pos.room] + pos.y * sizes[pos.room] + pos.x; }
+        Pos unpackPos(uint32_t packed) const
+        {
+            int room = static_cast<int>(std::upper_bound(offsets.begin(), offsets.end(), packed) - offsets.begin()) - 1;
+            int cell = packed - offsets[room];
+            return {room, cell % sizes[room], cell / sizes[room]};
+        }
+    };
+
+    static DynamicCompactState pack(const GameState& state, const Layout& layout)
+    {
+        DynamicCompactState compact;
+        compact.player = layout.packPos(state.player);
+        compact.boxrooms.assign(layout.sizes.size(), NOWHERE);
+        compact.boxes.reserve(state.boxes.size());
+        for (const auto& [bid, box]: state.boxes) {
+            compact.boxes.push_back(layout.packPos(box));
+        }
+        std::sort(compact.boxes.begin(), compact.boxes.end());
+        for (const auto& [rid, boxroom]: state.boxrooms) {
+            compact.boxrooms[rid] = layout.packPos(boxroom);
+        }
+        return compact;
+    }
+
+    GameState unpack(const Layout& layout) const
+    {
+        GameState state;
+        state.player = layout.unpackPos(player);
+        state.portal_just_passed = std::nullopt;
+        state.is_win = false;
+        for (size_t bid = 0; bid < boxes.size(); ++bid) {
+            state.boxes[static_cast<int>(bid)] = layout.unpackPos(boxes[bid]);
+        }
+        for (size_t rid = 0; rid < boxrooms.size(); ++rid) {
+            if (boxrooms[rid] != NOWHERE) {
+                state.boxrooms[static_cast<int>(rid)] = layout.unpackPos(boxrooms[rid]);
+            }
+        }
+        return state;
+    }
+
+    bool operator== (const DynamicCompactState& other) const
+    {
+        return player == other.player && boxrooms == other.boxrooms && boxes == other.boxes;
+    }
+    bool operator!= (const DynamicCompactState& other) const { return !(*this == other); }
+
+    uint64_t hash() const
+    {
+        uint64_t h = mixHash(0, player);
+        for (uint32_t boxroom: boxrooms) {
+            h = mixHash(h, boxroom);
+        }
+        for (uint32_t box: boxes) {
+            h = mixHash(h, box);
+        }
+        return h;
+    }
+};
+
+/// @brief Hash functor for compact states in unordered containers
+template <typename State>
+struct StateHash
+{
+    size_t operator() (const State& state) const { return static_cast<size_t>(state.hash()); }
+};
+
+/// @brief Converts between GameState and a compact state type of a level
+template <typename State>
+struct StateCodec
+{
+    explicit StateCodec(const std::vector<Room>&) {}
+    State pack(const GameState& state) const { return State::pack(state); }
+    GameState unpack(const State& state) const { return state.unpack(); }
+};
+
+/// @brief Converts between GameState and DynamicCompactState, which need the level's cell numbering
+template <>
+struct StateCodec<DynamicCompactState>
+{
+    DynamicCompactState::Layout layout;
+
+    explicit StateCodec(const std::vector<Room>& rooms) : layout(rooms) {}
+    DynamicCompactState pack(const GameState& state) const { return DynamicCompactState::pack(state, layout); }
+    GameState unpack(const DynamicCompactState& state) const { return state.unpack(layout); }
+};
+
+/// @brief Call f with a default-constructed CompactState<N, R> of the smallest instantiation that
+///        fits the level, or with a DynamicCompactState when none does
+/// @details Lets templated code (search, batch simulation) pick a compile-time specialization
+///          at run time, e.g. withCompactState(rooms, [&](auto tag) { using State = decltype(tag); ... });
+template <typename F>
+decltype(auto) withCompactState(const std::vector<Room>& rooms, F&& f)
+{
+    if (CompactState<8, 4>::fits(rooms)) {
+        return f(CompactState<8, 4>{});
+    }
+    if (CompactState<16, 4>::fits(rooms)) {
+        return f(CompactState<16, 4>{});
+    }
+    if (CompactState<16, COMPACT_MAX_ROOMS>::fits(rooms)) {
+        return f(CompactState<16, COMPACT_MAX_ROOMS>{});
+    }
+    return f(DynamicCompactState{});
+}
+
+#endif
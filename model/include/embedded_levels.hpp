@@ -0,0 +1,21 @@
+#ifndef EMBEDDED_LEVELS_HPP
+#define EMBEDDED_LEVELS_HPP
+
+#include "level_loader.hpp"
+
+#include <string>
+#include <vector>
+
+/// @brief File names of the levels built into the program (e.g. "l1.json"), in campaign order
+/// @details The built-in levels are the files of model/levels listed in model/levels/campaign.txt at
+///          build time. They are parsed by the compiler into static room tables, so loading them reads
+///          and parses nothing.
+std::vector<std::string> embeddedLevelNames();
+
+/// @brief Build a built-in level from its compile-time room tables
+/// @param name File name of the level in model/levels, e.g. "l1.json"
+/// @param level Receives the level, equal to what LevelLoader::loadLevel() reads from the file
+/// @return False if no level of that name is built in
+bool loadEmbeddedLevel(const std::string& name, Level& level);
+
+#endif
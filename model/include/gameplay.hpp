@@ -6,6 +6,7 @@
 #include <vector>
 #include <optional>
 #include <map>
+#include <cstdint>
 
 /// @brief Position of a character (player/box) in the game world
 /// @details Represents a 3D coordinate system where characters can exist in different rooms
@@ -28,6 +29,10 @@ struct GameState
     std::map<int, Pos> boxrooms;               ///< Positions of all box rooms (room_id -> position)
     std::optional<Pos> portal_just_passed;    ///< Portal position if player just used one (for rendering)
     bool is_win;                              ///< True if the player has won the game
+    int targets_remaining = 0;                ///< Box targets not covered by a box or box room, kept up to date by GamePlay
+    int stuck_objects = 0;                    ///< Boxes and box rooms that can never cover a target, kept up to date by GamePlay
+    bool is_deadlocked = false;               ///< True if too few boxes and box rooms can still cover the targets to win
+    uint64_t hash = 0;                        ///< Zobrist hash of the entity positions, kept up to date by GamePlay
 };
 
 /// @brief Player input directions for movement
@@ -49,6 +54,75 @@ enum CellType
     BOXROOM   
 };
 
+/// @brief Entity occupying a single grid cell
+/// @details Entries of the per-room occupancy grid kept by GamePlay, so that the
+///          object at a position can be found without scanning the state maps.
+struct Occupant
+{
+    CellType type;    ///< PLAYER, BOX, BOXROOM, or SPACE for an unoccupied cell
+    int id;           ///< Box id or box room id (-1 for PLAYER and SPACE)
+};
+
+/// @brief A single entity displacement produced by GamePlay::operate()
+/// @details The events of a move describe exactly what changed between the current and the
+///          next state, so views can animate only the entities that moved and replays can
+///          store deltas instead of whole states.
+struct MoveEvent
+{
+    Occupant object;              ///< The entity that moved (PLAYER, BOX or BOXROOM and its id)
+    Pos from;                     ///< Position before the move
+    Pos to;                       ///< Position after the move
+    std::optional<Pos> portal;    ///< Entry cell of the last box-room entry crossed on the way, if any
+};
+
+/// @brief One move of GamePlay's undo journal
+struct JournalEntry
+{
+    size_t first;                 ///< Index of the move's first event in the journal's events
+    size_t count;                 ///< Number of events of the move
+    std::optional<Pos> portal;    ///< portal_just_passed after the move
+    int frozen;                   ///< Objects the move froze off target (added to stuck_objects)
+};
+
+/// @brief Everything needed to resume a game exactly: its current state and undo journal
+/// @details Filled by GamePlay::saveSession() and applied by GamePlay::restoreSession().
+struct GameSession
+{
+    GameState state;                        ///< Current state
+    std::vector<MoveEvent> journal;         ///< Events of all journaled moves, back to back
+    std::vector<JournalEntry> entries;      ///< Journaled moves, oldest first
+    size_t position = 0;                    ///< Number of journaled moves applied; the others can be redone
+};
+
+/// @brief Scratch storage of resolvePush(), reused across moves to avoid allocation
+struct PushScratch
+{
+    /// @brief One object of a push chain being resolved
+    struct Frame
+    {
+        Occupant object;              ///< The entity trying to move
+        Pos from;                     ///< Its current position
+        Pos to;                       ///< The cell it is trying to move into
+        Occupant blocker;             ///< What occupied 'to' when it was last examined
+        int enters;                   ///< Number of box rooms entered so far by this object
+        std::optional<Pos> portal;    ///< Entry cell of the last portal crossed
+        size_t first_move;            ///< Number of resolved moves when this frame was opened
+    };
+
+    std::vector<Frame> frames;           ///< Stack of the chain being resolved
+    std::vector<uint32_t> chainMarks;    ///< Per (cell, direction): generation while the cell is part of the chain
+    std::vector<uint32_t> failedMarks;   ///< Per (cell, direction): generation once pushing from the cell failed
+    uint32_t generation = 0;             ///< Marks equal to it belong to the move being resolved
+
+    /// @brief Size the marks for a level with this many cells
+    void resize(int cells)
+    {
+        chainMarks.assign(static_cast<size_t>(cells) * 4, 0);
+        failedMarks.assign(static_cast<size_t>(cells) * 4, 0);
+        generation = 0;
+    }
+};
+
 /// @brief Game manager for sokoban game, handling game logic and maintaining game state
 /// @details This class manages the game mechanics, processes player input, updates game state,
 ///          and handles the special portal mechanics unique to this variant of sokoban.
@@ -57,23 +131,108 @@ class GamePlay
 public:
     /// @brief Initialize a game with a loaded level
     /// @param level The level data containing rooms and initial layout
+    /// @throws std::runtime_error if a box room marker names no room of the level or a box room is placed twice
     GamePlay(const Level level);
 
     /// @brief Get the current game state
     /// @return Current game state including all character positions
-    GameState getCurrState();
+    const GameState& getCurrState() const;
 
     /// @brief Get the next game state (after pending operations are applied)
     /// @return The game state that will become current after updateState() is called
-    GameState getNextState();
+    const GameState& getNextState() const;
+
+    /// @brief Replace the current state, discarding any pending operation
+    /// @details Used by search and tools to evaluate moves from arbitrary positions.
+    ///          The state must place every entity of the level on a distinct free cell.
+    /// @param state The new current state (its is_win flag is recomputed)
+    void setState(const GameState& state);
+
+    /// @brief Compute the Zobrist hash of a state from scratch
+    /// @details Boxes share keys, so states that differ only in box ids hash alike.
+    ///          operate() and updateState() maintain GameState::hash incrementally.
+    uint64_t hashState(const GameState& state) const;
+
+    /// @brief Get the rooms of the level being played
+    const std::vector<Room>& getRooms() const;
+
+    /// @brief Get the cell the player has to reach
+    Pos getPlayerDestination() const;
+
+    /// @brief Get the cells that have to be covered by a box or box room
+    const std::vector<Pos>& getBoxDestinations() const;
+
+    /// @brief Whether a box or box room on this cell can never be pushed onto a box target
+    /// @details Found once per level by the constructor, taking box room entries and exits into account.
+    bool isDeadSquare(Pos pos) const;
+
+    /// @brief Zobrist key of an object standing on a cell
+    /// @details GameState::hash is the XOR of the keys of all objects; boxes share keys.
+    uint64_t zobristKey(Occupant object, Pos pos) const;
 
     /// @brief Process player input and calculate the resulting game state
     /// @param input Player's move direction (UP/DOWN/LEFT/RIGHT)
     void operate(Input input);
 
+    /// @brief Compute what a move would do without changing any state
+    /// @details Resolves the move against the current state exactly like operate(), but writes
+    ///          the would-be displacements (each with the entry it crosses, if any) to a buffer
+    ///          owned by the caller, which can be reused across calls to avoid allocation.
+    ///          Not thread-safe: it shares its resolution scratch storage with operate().
+    /// @param input Player's move direction (UP/DOWN/LEFT/RIGHT)
+    /// @param events Receives the displacements; emptied if the move is blocked
+    /// @return False if the move is blocked
+    bool previewMove(Input input, std::vector<MoveEvent>& events) const;
+
+    /// @brief Whether a move from the current state would displace anything
+    bool canMove(Input input) const;
+
+    /// @brief Get the entity displacements of the latest operate()
+    /// @details Empty if the move was blocked. They remain available after updateState(),
+    ///          describing the transition that was just applied, until the next operate(),
+    ///          undo() (which clears them) or redo().
+    const std::vector<MoveEvent>& getMoveEvents() const;
+
     /// @brief Apply the pending state changes and make them current
-    /// @details Replaces current state with next state and clears the next state
+    /// @details Replaces current state with next state; only the entities that moved are updated.
+    ///          A move that displaced anything is recorded in the undo journal, dropping any redo history.
     void updateState();
+
+    /// @brief Whether there is an applied move to undo
+    bool canUndo() const;
+
+    /// @brief Whether there is an undone move to redo
+    bool canRedo() const;
+
+    /// @brief Revert the latest applied move, discarding any pending operation
+    /// @details Runs in time proportional to the number of entities the move displaced.
+    /// @return False if there was nothing to undo
+    bool undo();
+
+    /// @brief Re-apply the latest undone move; getMoveEvents() then describes it
+    /// @return False if there was nothing to redo
+    bool redo();
+
+    /// @brief Undo up to the given number of moves
+    /// @details O(moves); the journal is kept, so the moves can be redone afterwards.
+    /// @return Number of moves actually undone
+    int rewind(int moves);
+
+    /// @brief Number of applied moves in the undo journal
+    int getMoveCount() const;
+
+    /// @brief Copy the current state and the undo journal
+    /// @details Assigns into the session's containers, so refilling the same session reuses their storage.
+    ///          A pending operation (operate() without updateState()) is not part of it.
+    void saveSession(GameSession& session) const;
+
+    /// @brief Resume a saved game: replace the current state and the undo journal
+    /// @details Derived fields of the state (hash, win, target and deadlock status) are recomputed, and
+    ///          so are the journal's frozen counts, so undo and redo match a fresh game in each state.
+    ///          The session is checked before anything changes, so the game is untouched if it is rejected.
+    /// @throws std::runtime_error if the session does not fit this level (unknown objects, positions
+    ///         off the floor, two objects on one cell, or a journal that does not lead to the state)
+    void restoreSession(const GameSession& session);
 private:
     Pos playerDestination;                     ///< Calculated destination for player movement
     std::vector<Pos> boxDestinations;          ///< Calculated destinations for box movements
@@ -81,9 +240,51 @@ private:
     GameState currState;                       ///< Current state of the game
     GameState nextState;                       ///< Next state after operations are applied
 
+    std::vector<std::vector<Occupant>> occupancy;   ///< Per-room grid (row-major, room size stride) mirroring currState
+    std::vector<MoveEvent> moveEvents;              ///< Moves of the latest operate(), from currState to nextState
+    bool movesApplied = true;                       ///< Whether updateState() has applied moveEvents
+    std::vector<int> roomCellOffsets;               ///< Index of each room's first cell in a level-wide cell numbering
+    std::vector<uint64_t> zobristKeys;              ///< Per (cell, player / box / box room id) random keys
+    std::vector<uint8_t> boxTargetCells;            ///< Per level-wide cell: 1 if it is a box target
+    std::vector<uint8_t> deadCells;                 ///< Per level-wide cell: 1 if it is a dead square
+    int pendingFrozen = 0;                          ///< Objects frozen off target by the pending moveEvents
+    std::vector<MoveEvent> journal;                 ///< Events of all journaled moves, back to back
+    std::vector<JournalEntry> journalEntries;       ///< Journaled moves, oldest first
+    size_t journalPos = 0;                          ///< Number of journaled moves currently applied
+    std::vector<MoveEvent> freezeCandidates;        ///< Objects of operate() that may have become frozen, from and to
+
+    mutable PushScratch pushScratch;               ///< Scratch storage of resolveMove()
+    mutable std::vector<MoveEvent> previewScratch;  ///< Events buffer of canMove()
+
+    Occupant& occupantAt(Pos pos);
+    const Occupant& occupantAt(Pos pos) const;
+    bool isInside(Pos pos) const;
+    void moveEntity(GameState& state, Occupant object, Pos from, Pos to) const;
+    void discardPendingMoves();
+    void moveOnGrid(const MoveEvent* first, const MoveEvent* last, bool forward);
+    void applyJournalEntry(const JournalEntry& entry, bool forward);
+    void markDeadSquares();
+    bool canPassSide(Pos pos, Input side) const;
+    bool isFrozen(Pos pos) const;
+    bool isBlockedOnAxis(Pos pos, bool horizontal) const;
+    bool isFrozenOffTarget(Pos pos) const;
+    void addFreezeCandidates(Pos cell);
+    int countStuckObjects(const GameState& state) const;
+    bool checkDeadlock(const GameState& state) const;
+    bool checkWin(const GameState& state) const;
+    int countTargetsRemaining(const GameState& state) const;
+    int cellIndex(Pos pos) const;
+    int cellKey(Pos pos, Input move) const;
+    CellType getCellType(Pos cell_pos) const;
+    Pos stepFrom(Pos pos, Input move, std::optional<Pos>& portal) const;
+    bool findEntry(int boxroom_id, Input move, Pos& entry_pos) const;
+    bool resolveMove(Input move, std::vector<MoveEvent>& moves) const;
 
-    CellType getCellType(Pos cell_pos);
-    CellType operateMove(CellType object_to_move, Pos object_curr_pos, Input move);
+    // World interface of resolvePush()
+    template <typename World>
+    friend bool resolvePush(const World& world, Input move, PushScratch& scratch, std::vector<MoveEvent>& moves);
+    Pos playerPosition() const { return currState.player; }
+    int roomCount() const { return static_cast<int>(rooms.size()); }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef LEVEL_GENERATOR_HPP
+#define LEVEL_GENERATOR_HPP
+
+#include "level_loader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Parameters of generateLevel()
+struct GeneratorOptions
+{
+    int min_size = 7;                       ///< Smallest side of the main room
+    int max_size = 9;                       ///< Largest side of the main room
+    int min_boxes = 1;                      ///< Fewest boxes
+    int max_boxes = 3;                      ///< Most boxes
+    double boxroom_chance = 0.6;            ///< Chance that the level has a box room
+    int scramble_moves = 300;               ///< Reverse moves made from the solved configuration
+    int min_moves = 15;                     ///< Shortest optimal solution kept
+    int max_moves = 80;                     ///< Longest optimal solution kept
+    double min_branching = 1.5;             ///< Lowest mean number of possible moves along the solution
+    double max_branching = 4.0;             ///< Highest mean number of possible moves along the solution
+    size_t max_states = 300000;             ///< Solver state limit per candidate
+    size_t table_bytes = size_t(16) << 20;  ///< Solver table budget per candidate
+};
+
+/// @brief A level accepted by generateLevel() and what the solver found about it
+struct GeneratedLevel
+{
+    Level level;             ///< The level, ready for LevelLoader::saveLevel()
+    int moves = 0;           ///< Length of its shortest solution
+    double branching = 0;    ///< Mean number of moves that change the state, along that solution
+    size_t states = 0;       ///< States the solver stored to prove the length
+};
+
+/// @brief Generate one candidate level and check it against the target band
+/// @details A main room, and possibly a box room inside it, are built from parametric templates
+///          (open, pillared, divided or notched rooms with scattered walls). Objects are put on their
+///          targets and then scrambled by random reverse moves: the player steps back, possibly
+///          pulling the object in front of it, also through box room entries. Each reverse move is
+///          confirmed by replaying it forwards with GamePlay::operate(). The solver then checks
+///          the optimal solution length and branching of the result.
+///          Deterministic: the same options and seed give the same outcome.
+/// @param options Templates and target band
+/// @param seed Seed of the candidate
+/// @param result Receives the level if it is accepted
+/// @return True if the candidate is solvable and within the band
+bool generateLevel(const GeneratorOptions& options, uint64_t seed, GeneratedLevel& result);
+
+#endif
@@ -1,20 +1,58 @@
 #ifndef LEVEL_LOADER_HPP
 #define LEVEL_LOADER_HPP
 
-#define MAX_SIZE 12
-
 #include <json.hpp>
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
+#include <cstdint>
 
 using json = nlohmann::json;
 
+/// @brief Static terrain of a single cell, stored as one byte per cell
+enum CellKind : uint8_t
+{
+    CELL_FLOOR,            ///< "." empty floor (also under the "p", "b" and "0"-"9" markers)
+    CELL_WALL,             ///< "#" wall
+    CELL_PORTAL_WALL,      ///< "|" portal-bearing wall segment
+    CELL_PLAYER_TARGET,    ///< "=" player destination
+    CELL_BOX_TARGET        ///< "_" box destination
+};
+
+/// @brief Kinds of movable objects placed by a level layout
+enum MarkerKind : uint8_t
+{
+    MARKER_PLAYER,     ///< "p" player start
+    MARKER_BOX,        ///< "b" box start
+    MARKER_BOXROOM     ///< "0"-"9" box room start
+};
+
+/// @brief Initial placement of a movable object, kept beside the terrain grid
+struct Marker
+{
+    MarkerKind kind;    ///< What is placed at this cell
+    uint8_t digit;      ///< Box room id for MARKER_BOXROOM, 0 otherwise
+    uint16_t x;         ///< X position in the room
+    uint16_t y;         ///< Y position in the room
+};
+
+/// @brief Border sides of a room
+/// @details Ordered like Input (UP, DOWN, LEFT, RIGHT): a move leaves a room through the side
+///          with the same value and enters a box room through the opposite one (side ^ 1).
+enum RoomSide : uint8_t
+{
+    SIDE_TOP,       ///< y == 0
+    SIDE_BOTTOM,    ///< y == size - 1
+    SIDE_LEFT,      ///< x == 0
+    SIDE_RIGHT      ///< x == size - 1
+};
+
 /// @brief A scene representing the 2D layout of a level
-/// @details Contains the fixed walls ("#") and movable spaces/portals (".") in a level.
-///          Each cell is represented as a string to accommodate various game elements.
-using Scene = std::array<std::array<std::string, MAX_SIZE>, MAX_SIZE>;
+/// @details Packed row-major grid of CellKind values (index y * size + x), sized to
+///          the room it belongs to. Movable objects are not part of the scene, see Room::markers.
+using Scene = std::vector<uint8_t>;
 
 /// @brief Represents a single room in the game level
 /// @details A room can be either a regular room or a "box room" that can be entered
@@ -24,7 +62,33 @@ struct Room
     int size;                                    ///< Size of the room (width and height)
     bool is_box;                                ///< True if this room can be entered via a box
     std::vector<std::array<int, 2>> entries;    ///< Entry points [y, x] where player can enter this room
-    Scene scene;                                ///< 2D layout of the room
+    Scene scene;                                ///< Static terrain of the room
+    std::vector<Marker> markers;                ///< Initial player, box and box room placements
+    std::vector<int16_t> entryLookup;           ///< Per (side, coordinate along it): index into entries, -1 if none
+    std::array<int16_t, 4> sideEntries{};       ///< Per side: first entry on it, -1 if none
+
+    /// @brief Terrain of the cell at (x, y)
+    CellKind cellAt(int x, int y) const { return static_cast<CellKind>(scene[y * size + x]); }
+
+    /// @brief Build entryLookup and sideEntries from size and entries
+    /// @details Done by LevelLoader; call it again after changing the entries of a room.
+    void indexEntries();
+
+    /// @brief Index into entries of the entry at (x, y) if that cell lies on the given side, -1 otherwise
+    int entryOn(RoomSide side, int x, int y) const
+    {
+        bool horizontal = side == SIDE_TOP || side == SIDE_BOTTOM;
+        int across = horizontal ? y : x;
+        int along = horizontal ? x : y;
+        int edge = (side == SIDE_TOP || side == SIDE_LEFT) ? 0 : size - 1;
+        if (across != edge || along < 0 || along >= size) {
+            return -1;
+        }
+        return entryLookup[side * size + along];
+    }
+
+    /// @brief Index into entries of the first entry on the given side, -1 if none
+    int firstEntryOn(RoomSide side) const { return sideEntries[side]; }
 };
 
 /// @brief Represents a complete game level
@@ -39,14 +103,58 @@ struct Level
 /// @brief Utility class for loading game levels from JSON files
 /// @details This class provides static methods to parse JSON level files and convert them
 ///          into Level structures that can be used by the game engine.
+///          Levels can also be compiled into a binary format (.ppl), which is memory-mapped and
+///          copied into the Level room by room instead of being parsed cell by cell.
 class LevelLoader{
 public:
+    /// @brief Version of the binary level format written by saveBinaryLevel()
+    static constexpr uint16_t BINARY_VERSION = 1;
+
     /// @brief Load a level from a JSON file
+    /// @details A compiled copy next to the file (see binaryPath()) is loaded instead when it was
+    ///          compiled from the file's current contents, or when the JSON file is missing. A path
+    ///          ending in ".ppl" is loaded as binary. Without a usable compiled copy the JSON is parsed.
+    ///          Both files are read through Assets (asset_archive.hpp), from the mounted archive if it holds them.
     /// @param level_path Path to the level file (e.g., "path/to/level.json")
     /// @return Level structure containing the parsed level data
     /// @throws std::runtime_error if file cannot be read or JSON is invalid
     static Level loadLevel(const std::string& level_path);
 
+    /// @brief Build a level from the text of a JSON level file
+    /// @throws std::runtime_error or json::exception if the text is not a valid level
+    static Level parseLevel(std::string_view text);
+
+    /// @brief Load a level from a binary level file
+    /// @param level_path Path to the .ppl file
+    /// @throws std::runtime_error if the file cannot be mapped or is not a valid level of BINARY_VERSION
+    static Level loadBinaryLevel(const std::string& level_path);
+
+    /// @brief Write a level in the binary format
+    /// @param level The level to write
+    /// @param level_path Path of the file to create or replace
+    /// @param source_hash sourceHash() of the JSON text the level was read from, 0 if none; loadLevel()
+    ///        only prefers the binary file to a JSON file with that hash
+    /// @throws std::runtime_error if the file cannot be written
+    static void saveBinaryLevel(const Level& level, const std::string& level_path, uint64_t source_hash = 0);
+
+    /// @brief Compile a JSON level file into its binary copy at binaryPath(level_path)
+    /// @return Path of the binary file
+    /// @throws std::runtime_error if the level cannot be read or the copy cannot be written
+    static std::string compileLevel(const std::string& level_path);
+
+    /// @brief Path of the compiled copy of a JSON level file: the same path with the extension ".ppl"
+    static std::string binaryPath(const std::string& level_path);
+
+    /// @brief Hash identifying the text of a JSON level file (64-bit FNV-1a)
+    static uint64_t sourceHash(std::string_view text);
+
+    /// @brief Write a level as a JSON file that loadLevel() reads back unchanged
+    /// @details Uses the layout of the hand-written level files, one row per line.
+    /// @param level The level to write; a marker may not stand on a target cell, which the format cannot express
+    /// @param level_path Path of the file to create or replace
+    /// @throws std::runtime_error if the level cannot be expressed or the file cannot be written
+    static void saveLevel(const Level& level, const std::string& level_path);
+
     LevelLoader() = delete;
     LevelLoader(const LevelLoader&) = delete;
     LevelLoader& operator=(const LevelLoader&) = delete;
@@ -0,0 +1,160 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// @brief Read-only memory mapping of a whole file
+/// @details The bytes stay valid, and are paged in on first access, while the object holds the
+///          mapping. An empty file opens successfully with no data.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    /// @throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path)
+    {
+        if (!open(path)) {
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+    }
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { swap(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    /// @brief Map a file, replacing any current mapping
+    /// @return False if the file cannot be opened or mapped (the object is then closed)
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size)) {
+            close();
+            return false;
+        }
+        length = static_cast<size_t>(file_size.QuadPart);
+        if (length > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!view) {
+                close();
+                return false;
+            }
+            bytes = static_cast<const uint8_t*>(view);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            bytes = static_cast<const uint8_t*>(view);
+        }
+        // the mapping outlives the descriptor
+        ::close(fd);
+#endif
+        opened = true;
+        return true;
+    }
+
+    /// @brief Release the mapping
+    void close()
+    {
+#ifdef _WIN32
+        if (bytes) {
+            UnmapViewOfFile(bytes);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) {
+            munmap(const_cast<uint8_t*>(bytes), length);
+        }
+#endif
+        bytes = nullptr;
+        length = 0;
+        opened = false;
+    }
+
+    /// @brief Whether a file is mapped
+    bool isOpen() const { return opened; }
+
+    /// @brief First byte of the file, nullptr if it is empty or none is mapped
+    const uint8_t* data() const { return bytes; }
+
+    /// @brief Size of the file in bytes
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    void swap(MappedFile& other) noexcept
+    {
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        std::swap(opened, other.opened);
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#endif
+    }
+};
+
+#endif
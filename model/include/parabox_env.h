@@ -0,0 +1,106 @@
+#ifndef PARABOX_ENV_H
+#define PARABOX_ENV_H
+
+/*
+ * C interface of the game logic, for driving many games in-process from other languages
+ * (e.g. training harnesses through ctypes / cffi). Only plain C types cross the boundary:
+ * no exceptions, no C++ objects, and the caller owns every buffer. Functions returning
+ * int32_t return PARABOX_OK or a negative PARABOX_ERROR_* code; parabox_last_error()
+ * then describes the failure.
+ *
+ * An environment holds N games of one level. Actions are one byte per game: 0 up,
+ * 1 down, 2 left, 3 right, in room coordinates (the game's Input values).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(PARABOX_BUILD)
+#    define PARABOX_API __declspec(dllexport)
+#  else
+#    define PARABOX_API __declspec(dllimport)
+#  endif
+#else
+#  define PARABOX_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented whenever a declaration of this header changes incompatibly */
+#define PARABOX_ABI_VERSION 1
+
+enum
+{
+    PARABOX_OK = 0,
+    PARABOX_ERROR_INVALID_ARGUMENT = -1,    /* null pointer, bad action or index out of range */
+    PARABOX_ERROR_LEVEL = -2,               /* the level file could not be loaded */
+    PARABOX_ERROR_BUFFER_TOO_SMALL = -3     /* see parabox_observation_shape() */
+};
+
+/* Channels of an observation, one byte per cell each */
+enum
+{
+    PARABOX_CHANNEL_WALL = 0,           /* 1 on walls, portal walls and padding outside the room */
+    PARABOX_CHANNEL_BOX_TARGET = 1,     /* 1 on box targets */
+    PARABOX_CHANNEL_PLAYER_TARGET = 2,  /* 1 on the player target */
+    PARABOX_CHANNEL_BOX = 3,            /* 1 where a box stands */
+    PARABOX_CHANNEL_BOXROOM = 4,        /* room id + 1 where a box room stands */
+    PARABOX_CHANNEL_PLAYER = 5,         /* 1 where the player stands */
+    PARABOX_CHANNEL_COUNT = 6
+};
+
+/* Dimensions of the observation tensor written by parabox_get_observation():
+ * uint8[envs][rooms][channels][size][size], row-major, rooms padded to the largest one. */
+typedef struct ParaboxObservationShape
+{
+    uint32_t envs;
+    uint32_t rooms;
+    uint32_t channels;
+    uint32_t size;
+    size_t bytes;       /* total size of the tensor */
+} ParaboxObservationShape;
+
+typedef struct ParaboxEnv ParaboxEnv;
+
+/* PARABOX_ABI_VERSION of the loaded library */
+PARABOX_API uint32_t parabox_abi_version(void);
+
+/* Description of the latest error of the calling thread ("" if none), valid until the
+ * next failing call on that thread */
+PARABOX_API const char* parabox_last_error(void);
+
+/* Create 'envs' games of the level at 'level_path', stepped on 'threads' threads
+ * (0 = one per hardware thread). Returns NULL on failure. */
+PARABOX_API ParaboxEnv* parabox_create(const char* level_path, uint32_t envs, int32_t threads);
+
+/* Free an environment; null is ignored */
+PARABOX_API void parabox_destroy(ParaboxEnv* env);
+
+/* Put every game back to the initial state. A non-null 'level_path' switches to that
+ * level first (the observation shape may change); on failure the environment is unchanged. */
+PARABOX_API int32_t parabox_reset(ParaboxEnv* env, const char* level_path);
+
+/* Put one game back to the initial state */
+PARABOX_API int32_t parabox_reset_one(ParaboxEnv* env, uint32_t index);
+
+/* Make one move in every game. 'actions' holds one byte per game. The optional outputs
+ * receive one byte per game: whether the move displaced anything, and whether the game is won. */
+PARABOX_API int32_t parabox_step(ParaboxEnv* env, const uint8_t* actions, uint8_t* moved, uint8_t* won);
+
+/* Dimensions of the observation tensor of the current level */
+PARABOX_API int32_t parabox_observation_shape(const ParaboxEnv* env, ParaboxObservationShape* shape);
+
+/* Write the observation of every game into 'buffer' of 'buffer_size' bytes */
+PARABOX_API int32_t parabox_get_observation(const ParaboxEnv* env, uint8_t* buffer, size_t buffer_size);
+
+/* Copy the state hash of every game (equal to GameState::hash) into 'hashes' */
+PARABOX_API int32_t parabox_get_hashes(const ParaboxEnv* env, uint64_t* hashes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
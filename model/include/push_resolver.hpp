@@ -0,0 +1,139 @@
+#ifndef PUSH_RESOLVER_HPP
+#define PUSH_RESOLVER_HPP
+
+#include "gameplay.hpp"
+
+#include <algorithm>
+#include <vector>
+
+/// @brief Resolve the push chain of one move against a game world
+/// @details The single implementation of the movement rules, shared by GamePlay and
+///          BatchSimulator, which store the positions of their objects differently.
+///          World provides, for its current state:
+///          - Pos playerPosition() const
+///          - int roomCount() const
+///          - CellType getCellType(Pos) const: WALL outside rooms and on walls, else what occupies the cell
+///          - const Occupant& occupantAt(Pos) const (or by value)
+///          - Pos stepFrom(Pos, Input, std::optional<Pos>& portal) const: the neighbouring cell,
+///            leaving a placed box room through its entries (setting 'portal')
+///          - bool findEntry(int boxroom_id, Input, Pos&) const: the entry a move enters a box room by
+///          - int cellKey(Pos, Input) const: a dense index below scratch.chainMarks.size()
+/// @param world The state to resolve the move in
+/// @param move Player's move direction
+/// @param scratch Storage reused across calls; its marks must be sized for the world's cells
+/// @param moves Receives the displacements, emptied if the move is blocked
+/// @return False if the move is blocked
+template <typename World>
+bool resolvePush(const World& world, Input move, PushScratch& scratch, std::vector<MoveEvent>& moves)
+{
+    // The player pushes whatever occupies the cell in front of it, which pushes the next
+    // object, and so on. An object blocked by a box room that cannot be pushed tries to
+    // enter it instead. The chain is resolved with an explicit stack of frames:
+    //  - a chain that reaches a cell already in the chain closes a loop: every object in
+    //    the loop moves into the cell vacated by the next one, and the objects pushing
+    //    into the loop from outside are blocked, since the loop refills the cell they target;
+    //  - a cell whose push already failed in this move fails again without being re-explored;
+    //  - an object that keeps entering box rooms more often than there are rooms is stuck.
+    // Each (cell, direction) is expanded at most once, so the cost is linear in the chain.
+    using Frame = PushScratch::Frame;
+    std::vector<Frame>& frames = scratch.frames;
+    std::vector<uint32_t>& chainMarks = scratch.chainMarks;
+    std::vector<uint32_t>& failedMarks = scratch.failedMarks;
+    moves.clear();
+    frames.clear();
+
+    if (++scratch.generation == 0) {
+        std::fill(chainMarks.begin(), chainMarks.end(), 0);
+        std::fill(failedMarks.begin(), failedMarks.end(), 0);
+        scratch.generation = 1;
+    }
+    const uint32_t generation = scratch.generation;
+
+    enum { DESCEND, SUCCEEDED, FAILED } status = DESCEND;
+    int loop_start = -1;    // index of the frame at which a closed loop starts
+
+    Frame root = {{PLAYER, -1}, world.playerPosition(), {}, {SPACE, -1}, 0, std::nullopt, 0};
+    root.to = world.stepFrom(root.from, move, root.portal);
+    frames.push_back(root);
+    chainMarks[world.cellKey(root.from, move)] = generation;
+
+    while (!frames.empty()) {
+        Frame& frame = frames.back();
+
+        if (status == DESCEND) {
+            // examine the cell the object is trying to move into
+            CellType type = world.getCellType(frame.to);
+            frame.blocker = (type == WALL || type == SPACE) ? Occupant{type, -1} : world.occupantAt(frame.to);
+
+            if (type == WALL) {
+                status = FAILED;
+            }
+            else if (type == SPACE) {
+                status = SUCCEEDED;
+            }
+            else if (chainMarks[world.cellKey(frame.to, move)] == generation) {
+                // the blocker is already being pushed: the chain loops
+                status = SUCCEEDED;
+                for (int i = 0; i < static_cast<int>(frames.size()); ++i) {
+                    if (frames[i].from == frame.to) {
+                        loop_start = i;
+                        break;
+                    }
+                }
+            }
+            else if (failedMarks[world.cellKey(frame.to, move)] == generation) {
+                status = FAILED;
+            }
+            else {
+                // try to push the object that occupies the target first
+                Frame next = {frame.blocker, frame.to, {}, {SPACE, -1}, 0, std::nullopt, moves.size()};
+                next.to = world.stepFrom(next.from, move, next.portal);
+                chainMarks[world.cellKey(next.from, move)] = generation;
+                frames.push_back(next);
+            }
+            continue;
+        }
+
+        // discard whatever the failed attempt had resolved
+        if (status == FAILED) {
+            moves.resize(frame.first_move);
+        }
+
+        // the occupying box-room can't be pushed, try to move in
+        if (status == FAILED && frame.blocker.type == BOXROOM && frame.enters < world.roomCount()) {
+            Pos entry_pos;
+            if (world.findEntry(frame.blocker.id, move, entry_pos)) {
+                frame.to = entry_pos;
+                frame.portal = entry_pos;
+                frame.enters++;
+                status = DESCEND;
+                continue;
+            }
+        }
+
+        if (status == SUCCEEDED) {
+            moves.push_back({frame.object, frame.from, frame.to, frame.portal});
+        }
+        else {
+            failedMarks[world.cellKey(frame.from, move)] = generation;
+        }
+        chainMarks[world.cellKey(frame.from, move)] = 0;
+        frames.pop_back();
+
+        // the loop refills the cell the frame below its start was moving into
+        if (status == SUCCEEDED && static_cast<int>(frames.size()) == loop_start) {
+            loop_start = -1;
+            if (!frames.empty()) {
+                status = FAILED;
+            }
+        }
+    }
+
+    if (status != SUCCEEDED) {
+        moves.clear();
+        return false;
+    }
+    return true;
+}
+
+#endif
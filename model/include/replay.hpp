@@ -0,0 +1,78 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include "gameplay.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/// @brief Kinds of recorded player actions
+enum ReplayAction : uint8_t
+{
+    REPLAY_MOVE,            ///< GamePlay move; value is the Input, already remapped for the camera
+    REPLAY_UNDO,            ///< Undo the latest move
+    REPLAY_REDO,            ///< Redo the latest undone move
+    REPLAY_RESTART,         ///< Rewind every applied move
+    REPLAY_ROTATE_CAMERA    ///< Camera turn; value is 0 for the U key, 1 for the I key. No effect on GamePlay
+};
+
+/// @brief One recorded action
+struct ReplayEvent
+{
+    uint32_t time_ms;       ///< Frame timestamp, in milliseconds since recording started
+    ReplayAction action;    ///< What was done
+    uint8_t value;          ///< Action argument, see ReplayAction
+};
+
+/// @brief A recorded play session
+/// @details Moves are stored as the inputs GamePlay received, so a replay re-simulates
+///          without any view state; camera turns are kept for playback in the game.
+struct Replay
+{
+    std::string level;                 ///< Level file the session was played on
+    uint64_t start_hash = 0;           ///< Hash of the level's initial state, to detect a changed level
+    uint64_t end_hash = 0;             ///< Hash of the state when recording stopped
+    std::vector<ReplayEvent> events;   ///< Actions in the order they were applied
+};
+
+/// @brief Outcome of re-simulating a replay
+struct ReplayResult
+{
+    bool start_matches = false;    ///< The level's initial state hash equals Replay::start_hash
+    bool end_matches = false;      ///< The final state hash equals Replay::end_hash
+    bool is_win = false;           ///< The final state wins the level
+    size_t moves = 0;              ///< Move, undo, redo and restart events applied
+    uint64_t end_hash = 0;         ///< Hash of the final state
+};
+
+/// @brief Reading and writing of replay files
+/// @details Little-endian binary: a header (magic "PPRP", format version, level path,
+///          start and end hashes, event count) followed by one record per event of a
+///          LEB128 time delta in milliseconds and a byte holding the action and its value.
+///          A typical move takes two bytes.
+class ReplayFile
+{
+public:
+    /// @brief Write a replay
+    /// @throws std::runtime_error if the file cannot be written
+    static void save(const std::string& path, const Replay& replay);
+
+    /// @brief Read a replay
+    /// @throws std::runtime_error if the file cannot be read or is not a valid replay
+    static Replay load(const std::string& path);
+
+    ReplayFile() = delete;
+    ReplayFile(const ReplayFile&) = delete;
+    ReplayFile& operator=(const ReplayFile&) = delete;
+};
+
+/// @brief Re-simulate a replay at full speed
+/// @details Resets the game to 'start' (clearing its undo journal), then applies every event
+///          through operate() / updateState(), undo(), redo() and rewind(). Camera turns are skipped.
+/// @param game Game of the replay's level; reusable across replays of the same level
+/// @param start The level's initial state
+/// @param replay The replay to run
+ReplayResult playReplay(GamePlay& game, const GameState& start, const Replay& replay);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SOLVER_HPP
+#define SOLVER_HPP
+
+#include "gameplay.hpp"
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/// @brief Search strategy used by solve()
+enum SolverAlgorithm
+{
+    SOLVER_BFS,     ///< Breadth-first search
+    SOLVER_ASTAR    ///< A* with an admissible, consistent relaxed-distance heuristic
+};
+
+/// @brief Parameters of a solver run
+struct SolverOptions
+{
+    SolverAlgorithm algorithm = SOLVER_ASTAR;   ///< Forward search strategy
+    bool bidirectional = false;                 ///< Also search backwards (pulling) from the goal states
+    int threads = 0;                            ///< Worker threads (0 = one per hardware thread)
+    size_t max_states = 0;                      ///< Give up after storing this many states (0 = no limit)
+    size_t table_bytes = size_t(1) << 30;       ///< Memory budget of the visited-state tables
+    size_t max_goal_states = 1 << 16;           ///< Bidirectional search is skipped when the level has more goal states
+    const GameState* start = nullptr;           ///< State to search from (nullptr = the level's initial state)
+    const std::atomic<bool>* cancel = nullptr;  ///< Polled by the workers; the search stops soon after it becomes true
+};
+
+/// @brief Outcome of a solver run
+struct SolveResult
+{
+    bool solved = false;                  ///< A solution was found
+    bool optimal = false;                 ///< The solution is known to be a shortest one (see solve())
+    bool exhausted = false;               ///< The whole reachable state space was explored without finding one
+    bool bidirectional = false;           ///< The backward search was actually used
+    bool table_full = false;              ///< The search stopped because the visited-state table was full
+    bool cancelled = false;               ///< The search stopped because SolverOptions::cancel was set
+    std::vector<Input> moves;             ///< Solution, shortest if optimal is set
+    size_t states = 0;                    ///< Distinct states stored (a state A* reopened counts once)
+    size_t expanded = 0;                  ///< States whose successors were generated
+    double seconds = 0;                   ///< Wall-clock search time
+    double states_per_second = 0;         ///< Distinct states stored per second
+    size_t peak_memory_bytes = 0;         ///< Peak resident memory of the process
+};
+
+/// @brief Find a shortest move sequence that wins a level
+/// @details Successors are generated with GamePlay::operate, so portals and box-room pushing
+///          behave exactly as in the game. Every move costs one step. Bidirectional mode runs
+///          breadth-first in both directions; its backward search pulls objects away from the
+///          goal states and keeps only predecessors that GamePlay confirms. It does not recover
+///          every predecessor of moves through box-room entries, of pushed box rooms or of closed
+///          loops. If it met such a move, the returned solution is valid but may be longer than the
+///          optimum, and SolveResult::optimal is false; BFS and A* solutions are always optimal.
+/// @param level The level to solve
+/// @param options Search parameters
+/// @return The solution, if any, and search statistics
+SolveResult solve(const Level& level, const SolverOptions& options = SolverOptions());
+
+/// @brief Render a move sequence as a string of U/D/L/R characters
+std::string movesToString(const std::vector<Input>& moves);
+
+/// @brief Peak resident memory of the current process in bytes (0 if unavailable)
+size_t peakMemoryBytes();
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef TRANSPOSITION_TABLE_HPP
+#define TRANSPOSITION_TABLE_HPP
+
+#include "gameplay.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/// @brief Bit-packs the entity positions of a level's states
+/// @details Every position is stored as a level-wide cell index using just enough bits for the
+///          level's total cell count: the player, then each box room by id (or an "absent"
+///          value), then the boxes in increasing cell order, since boxes are interchangeable.
+class StatePacker
+{
+public:
+    /// @brief Maximum packed size of a state, in 64-bit words
+    static constexpr int MAX_WORDS = 16;
+
+    /// @param rooms The level's rooms
+    /// @param layout Any state of the level, giving the number of boxes
+    StatePacker(const std::vector<Room>& rooms, const GameState& layout);
+
+    /// @brief Number of 64-bit words a packed state occupies
+    int words() const { return wordCount; }
+
+    /// @brief Write the packed form of a state to words()...words
+    void pack(const GameState& state, uint64_t* words) const;
+
+private:
+    std::vector<int> roomOffsets;
+    std::vector<int> roomSizes;
+    int boxCount;
+    int bitsPerPos;
+    int wordCount;
+};
+
+/// @brief Memory-bounded, lock-free set of game states keyed by their Zobrist hash
+/// @details Open addressing with linear probing. A slot is claimed by compare-and-swap on its
+///          key word and published with a release store once its packed state is written, so
+///          any number of threads may insert and query concurrently. The hash only selects the
+///          slot: states are compared in full, so hash collisions never merge distinct states.
+///          Each state also keeps the smallest depth it was inserted with, lowered atomically,
+///          so that a best-first search can reopen a state reached again by a shorter path.
+///          The table starts small and is grown by reserve() between parallel phases, never past
+///          the memory budget; once it reaches its maximum load, new states are refused with FULL.
+class TranspositionTable
+{
+public:
+    enum Result
+    {
+        INSERTED,   ///< The state was new and has been stored
+        IMPROVED,   ///< The state was stored with a greater depth, which has been lowered
+        PRESENT,    ///< The state was already stored with the same or a smaller depth
+        FULL        ///< The state is new but the memory budget is exhausted
+    };
+
+    /// @param rooms The level's rooms
+    /// @param layout Any state of the level, giving the number of boxes
+    /// @param memory_bytes Upper bound on the memory used by the table, also while reserve() grows it
+    TranspositionTable(const std::vector<Room>& rooms, const GameState& layout, size_t memory_bytes);
+
+    /// @brief Grow the table so that it can hold the given number of states
+    /// @details Not thread-safe: call it while no other thread uses the table.
+    /// @return False if the memory budget does not allow that many states
+    bool reserve(size_t states);
+
+    /// @brief Store a state (identified by state.hash and its positions)
+    /// @param depth Length of the path the state was reached by
+    Result insert(const GameState& state, uint32_t depth = 0);
+
+    /// @brief Whether a state is stored
+    bool contains(const GameState& state) const;
+
+    /// @brief Smallest depth a state was inserted with, NO_DEPTH if it is not stored
+    uint32_t depth(const GameState& state) const;
+
+    /// @brief depth() of a state that is not stored
+    static constexpr uint32_t NO_DEPTH = UINT32_MAX;
+
+    /// @brief Number of stored states
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+    /// @brief Maximum number of states the table accepts
+    size_t capacity() const { return limit; }
+
+    /// @brief Memory held by the table in bytes
+    size_t memoryBytes() const { return (mask + 1) * slotWords * sizeof(uint64_t); }
+
+private:
+    static constexpr uint64_t EMPTY = 0;
+    static constexpr uint64_t BUSY = 1;   ///< A slot whose state is being written
+
+    struct FreeDeleter
+    {
+        void operator() (std::atomic<uint64_t>* slots) const;
+    };
+
+    StatePacker packer;
+    size_t slotWords;   ///< Key word, depth word and packed state
+    size_t maxSlots;    ///< Largest slot count the memory budget allows
+    size_t mask;        ///< Slot count - 1 (the slot count is a power of two)
+    size_t limit;       ///< Maximum number of stored states (keeps probe sequences short)
+    std::unique_ptr<std::atomic<uint64_t>[], FreeDeleter> slots;
+    std::atomic<size_t> count{0};
+
+    static uint64_t keyOf(uint64_t hash) { return hash > BUSY ? hash : hash + 2; }
+    std::atomic<uint64_t>* slot(size_t index) const { return slots.get() + index * slotWords; }
+    bool matches(size_t index, const uint64_t* packed) const;
+    const std::atomic<uint64_t>* find(const uint64_t* packed, uint64_t key) const;
+    void allocate(size_t slot_count);
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief Runs index ranges on a fixed set of threads
+/// @details Each worker starts with an equal share of the range and takes small chunks from its
+///          front; a worker that runs dry steals the back half of the largest remaining share,
+///          so uneven costs per index balance out. The thread calling run() acts as worker 0.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int threads)
+    {
+        for (int i = 0; i < threads; ++i) {
+            ranges.push_back(std::make_unique<Range>());
+        }
+        // the calling thread acts as worker 0
+        for (int i = 1; i < threads; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker: workers) {
+            worker.join();
+        }
+    }
+
+    int size() const { return static_cast<int>(ranges.size()); }
+
+    /// @brief Call fn(worker, i) for every i in [0, count) and wait for all of them
+    void run(size_t count, const std::function<void(int, size_t)>& fn)
+    {
+        size_t share = (count + ranges.size() - 1) / ranges.size();
+        for (size_t w = 0; w < ranges.size(); ++w) {
+            std::lock_guard<std::mutex> lock(ranges[w]->mutex);
+            ranges[w]->begin = std::min(count, w * share);
+            ranges[w]->end = std::min(count, (w + 1) * share);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &fn;
+            finished = 0;
+            ++generation;
+        }
+        wake.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return finished == static_cast<int>(workers.size()); });
+        task = nullptr;
+    }
+
+private:
+    static constexpr size_t CHUNK = 32;
+
+    struct Range
+    {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    std::vector<std::unique_ptr<Range>> ranges;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int, size_t)>* task = nullptr;
+    uint64_t generation = 0;
+    int finished = 0;
+    bool stopping = false;
+
+    void workerLoop(int worker)
+    {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+            work(worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++finished;
+            }
+            done.notify_one();
+        }
+    }
+
+    void work(int worker)
+    {
+        size_t begin, end;
+        while (take(worker, begin, end) || (steal(worker) && take(worker, begin, end))) {
+            for (size_t i = begin; i < end; ++i) {
+                (*task)(worker, i);
+            }
+        }
+    }
+
+    bool take(int worker, size_t& begin, size_t& end)
+    {
+        Range& range = *ranges[worker];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        if (range.begin >= range.end) {
+            return false;
+        }
+        begin = range.begin;
+        end = std::min(range.end, range.begin + CHUNK);
+        range.begin = end;
+        return true;
+    }
+
+    bool steal(int worker)
+    {
+        int n = size();
+        while (true) {
+            // pick the victim with the largest remaining share; sizes may change meanwhile,
+            // so the choice is re-checked under the victim's lock
+            int victim_index = -1;
+            size_t largest = 0;
+            for (int k = 1; k < n; ++k) {
+                int candidate = (worker + k) % n;
+                Range& range = *ranges[candidate];
+                std::lock_guard<std::mutex> lock(range.mutex);
+                if (range.end > range.begin && range.end - range.begin > largest) {
+                    largest = range.end - range.begin;
+                    victim_index = candidate;
+                }
+            }
+            if (victim_index < 0) {
+                return false;
+            }
+
+            Range& victim = *ranges[victim_index];
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (victim.begin >= victim.end) {
+                    continue;    // emptied since the scan: look again
+                }
+                size_t remaining = victim.end - victim.begin;
+                begin = remaining <= CHUNK ? victim.begin : victim.begin + remaining / 2;
+                end = victim.end;
+                victim.end = begin;
+            }
+            Range& own = *ranges[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.begin = begin;
+            own.end = end;
+            return true;
+        }
+    }
+};
+
+#endif
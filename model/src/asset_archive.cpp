@@ -0,0 +1,304 @@
+#include "../include/asset_archive.hpp"
+#include "../include/mapped_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+/*
+ * Asset archive (.ppak). Little-endian; offsets count from the start of the file.
+ *   AssetFileHeader
+ *   AssetFileEntry[entry_count], sorted by name
+ *   names_size bytes holding the names back to back
+ *   the contents of each asset at its entry's offset, a multiple of AssetArchive::ALIGNMENT
+ */
+const char ASSET_FILE_MAGIC[4] = {'P', 'P', 'A', 'K'};
+
+struct AssetFileHeader
+{
+    char magic[4];           // ASSET_FILE_MAGIC
+    uint32_t version;        // AssetArchive::VERSION
+    uint32_t entry_count;
+    uint32_t names_size;
+    uint64_t file_size;
+};
+
+struct AssetFileEntry
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t name_offset;    // from the start of the names
+    uint32_t name_length;
+};
+
+static_assert(sizeof(AssetFileHeader) == 24 && sizeof(AssetFileEntry) == 24, "archive records must not be padded");
+
+uint64_t alignUp(uint64_t offset)
+{
+    return (offset + AssetArchive::ALIGNMENT - 1) / AssetArchive::ALIGNMENT * AssetArchive::ALIGNMENT;
+}
+
+/// @brief Contents of a loose file, not found if it cannot be mapped
+AssetData mapFile(const std::string& path)
+{
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path)) {
+        return {};
+    }
+    const uint8_t* data = file->data();
+    size_t size = file->size();
+    return AssetData(std::move(file), data, size);
+}
+
+/// @brief Directory of the running program, empty if it cannot be determined
+std::filesystem::path executableDirectory()
+{
+#ifdef _WIN32
+    char buffer[MAX_PATH];
+    DWORD length = GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) {
+        return {};
+    }
+    return std::filesystem::path(std::string(buffer, length)).parent_path();
+#else
+    std::error_code error;
+    std::filesystem::path program = std::filesystem::read_symlink("/proc/self/exe", error);
+    return error ? std::filesystem::path() : program.parent_path();
+#endif
+}
+
+/// @brief The archive read() looks in and the directory it was mounted from
+struct MountedArchive
+{
+    AssetArchive archive;
+    std::filesystem::path directory;
+};
+
+MountedArchive& mounted()
+{
+    static MountedArchive instance;
+    return instance;
+}
+
+} // namespace
+
+void AssetArchive::open(const std::string& path)
+{
+    auto invalid = [&](const std::string& what) {
+        return std::runtime_error("Invalid asset archive " + path + ": " + what);
+    };
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(path)) {
+        throw std::runtime_error("Cannot open asset archive: " + path);
+    }
+    const uint8_t* data = mapping->data();
+    size_t size = mapping->size();
+
+    AssetFileHeader header;
+    if (size < sizeof(header)) {
+        throw invalid("truncated header");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, ASSET_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw invalid("bad magic");
+    }
+    if (header.version != VERSION) {
+        throw invalid("unsupported version " + std::to_string(header.version));
+    }
+    size_t names_start = sizeof(header) + static_cast<size_t>(header.entry_count) * sizeof(AssetFileEntry);
+    if (header.file_size != size || names_start + header.names_size > size) {
+        throw invalid("truncated file");
+    }
+
+    // the table is copied once; the names and contents stay in the mapping
+    std::vector<Entry> table(header.entry_count);
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        AssetFileEntry record;
+        std::memcpy(&record, data + sizeof(header) + i * sizeof(AssetFileEntry), sizeof(record));
+        if (static_cast<uint64_t>(record.name_offset) + record.name_length > header.names_size) {
+            throw invalid("bad name of entry " + std::to_string(i));
+        }
+        if (record.offset % ALIGNMENT != 0 || record.offset > size || record.size > size - record.offset) {
+            throw invalid("bad contents of entry " + std::to_string(i));
+        }
+        table[i].name = std::string_view(reinterpret_cast<const char*>(data) + names_start + record.name_offset, record.name_length);
+        table[i].offset = record.offset;
+        table[i].size = record.size;
+        if (i > 0 && !(table[i - 1].name < table[i].name)) {
+            throw invalid("entries not sorted by name");
+        }
+    }
+    file = std::move(mapping);
+    entries = std::move(table);
+}
+
+AssetData AssetArchive::find(std::string_view name) const
+{
+    std::string key = normalize(name);
+    auto found = std::lower_bound(entries.begin(), entries.end(), key,
+                                  [](const Entry& entry, const std::string& k) { return entry.name < k; });
+    if (found == entries.end() || found->name != key) {
+        return {};
+    }
+    return AssetData(file, file->data() + found->offset, static_cast<size_t>(found->size));
+}
+
+std::vector<std::string> AssetArchive::names() const
+{
+    std::vector<std::string> result;
+    for (const auto& entry: entries) {
+        result.emplace_back(entry.name);
+    }
+    return result;
+}
+
+void AssetArchive::pack(std::vector<AssetSource> sources, const std::string& path)
+{
+    for (auto& source: sources) {
+        source.name = normalize(source.name);
+    }
+    std::sort(sources.begin(), sources.end(), [](const AssetSource& a, const AssetSource& b) { return a.name < b.name; });
+    for (size_t i = 1; i < sources.size(); ++i) {
+        if (sources[i].name == sources[i - 1].name) {
+            throw std::runtime_error("Asset stored twice: " + sources[i].name);
+        }
+    }
+
+    // the table and names first, then every file's contents at the next aligned offset
+    std::vector<MappedFile> contents(sources.size());
+    std::vector<AssetFileEntry> records(sources.size());
+    std::string names;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!contents[i].open(sources[i].path)) {
+            throw std::runtime_error("Cannot read asset file: " + sources[i].path);
+        }
+        records[i].name_offset = static_cast<uint32_t>(names.size());
+        records[i].name_length = static_cast<uint32_t>(sources[i].name.size());
+        records[i].size = contents[i].size();
+        names += sources[i].name;
+    }
+    uint64_t offset = sizeof(AssetFileHeader) + records.size() * sizeof(AssetFileEntry) + names.size();
+    for (auto& record: records) {
+        record.offset = alignUp(offset);
+        offset = record.offset + record.size;
+    }
+
+    AssetFileHeader header;
+    std::memcpy(header.magic, ASSET_FILE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.entry_count = static_cast<uint32_t>(records.size());
+    header.names_size = static_cast<uint32_t>(names.size());
+    header.file_size = offset;
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write asset archive: " + path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(AssetFileEntry));
+    out << names;
+    uint64_t written = sizeof(header) + records.size() * sizeof(AssetFileEntry) + names.size();
+    const char padding[ALIGNMENT] = {};
+    for (size_t i = 0; i < records.size(); ++i) {
+        out.write(padding, static_cast<std::streamsize>(records[i].offset - written));
+        out.write(reinterpret_cast<const char*>(contents[i].data()), static_cast<std::streamsize>(records[i].size));
+        written = records[i].offset + records[i].size;
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write asset archive: " + path);
+    }
+}
+
+std::string AssetArchive::normalize(std::string_view path)
+{
+    // a leading separator is kept, so that absolute paths never match a stored name
+    std::string name = !path.empty() && (path[0] == '/' || path[0] == '\\') ? "/" : "";
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find_first_of("/\\", start);
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+        std::string_view part = path.substr(start, end - start);
+        if (!part.empty() && part != ".") {
+            if (!name.empty() && name.back() != '/') {
+                name += '/';
+            }
+            name += part;
+        }
+        start = end + 1;
+    }
+    return name;
+}
+
+void Assets::mount(const std::string& archive_path)
+{
+    AssetArchive archive;
+    archive.open(archive_path);
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(archive_path, error);
+    mounted().archive = std::move(archive);
+    mounted().directory = error ? std::filesystem::path() : absolute.parent_path();
+}
+
+void Assets::unmount()
+{
+    mounted() = MountedArchive();
+}
+
+bool Assets::isMounted()
+{
+    return mounted().archive.isOpen();
+}
+
+std::string Assets::findArchive(const std::string& name)
+{
+    std::error_code error;
+    std::filesystem::path program_dir = executableDirectory();
+    if (!program_dir.empty() && std::filesystem::is_regular_file(program_dir / name, error)) {
+        return (program_dir / name).string();
+    }
+    for (std::filesystem::path dir = std::filesystem::current_path(error); !dir.empty(); dir = dir.parent_path()) {
+        if (std::filesystem::is_regular_file(dir / name, error)) {
+            return (dir / name).string();
+        }
+        if (dir == dir.parent_path()) {
+            break;
+        }
+    }
+    return {};
+}
+
+AssetData Assets::read(const std::string& path)
+{
+    const MountedArchive& current = mounted();
+    if (current.archive.isOpen()) {
+        AssetData data = current.archive.find(path);
+        if (data) {
+            return data;
+        }
+    }
+    AssetData data = mapFile(path);
+    if (!data && !current.directory.empty() && std::filesystem::path(path).is_relative()) {
+        data = mapFile((current.directory / path).string());
+    }
+    return data;
+}
+
+bool Assets::exists(const std::string& path)
+{
+    const MountedArchive& current = mounted();
+    if (current.archive.isOpen() && current.archive.find(path)) {
+        return true;
+    }
+    std::error_code error;
+    if (std::filesystem::is_regular_file(path, error)) {
+        return true;
+    }
+    return !current.directory.empty() && std::filesystem::path(path).is_relative()
+           && std::filesystem::is_regular_file(current.directory / path, error);
+}
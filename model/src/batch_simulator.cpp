@@ -0,0 +1,287 @@
+#include "../include/batch_simulator.hpp"
+#include "../include/push_resolver.hpp"
+#include "../include/work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+struct BatchSimulator::InstanceView
+{
+    const BatchSimulator& sim;
+    size_t instance;
+
+    const uint16_t* grid() const { return sim.occupancy.data() + instance * sim.cells; }
+
+    Pos playerPosition() const { return sim.cellPositions[sim.positions[instance]]; }
+
+    int roomCount() const { return static_cast<int>(sim.rooms.size()); }
+
+    CellType getCellType(Pos pos) const
+    {
+        // cells outside the room layout behave like walls
+        if (pos.room < 0 || pos.room >= roomCount()
+            || pos.x < 0 || pos.x >= sim.rooms[pos.room].size
+            || pos.y < 0 || pos.y >= sim.rooms[pos.room].size) {
+            return WALL;
+        }
+        int cell = sim.cellOf(pos);
+        if (sim.wallCells[cell]) {
+            return WALL;
+        }
+        uint16_t object = grid()[cell];
+        return object ? sim.objects[object - 1].type : SPACE;
+    }
+
+    Occupant occupantAt(Pos pos) const
+    {
+        uint16_t object = grid()[sim.cellOf(pos)];
+        return object ? sim.objects[object - 1] : Occupant{SPACE, -1};
+    }
+
+    Pos stepFrom(Pos pos, Input move, std::optional<Pos>& portal) const
+    {
+        static const int DX[4] = {0, 0, -1, 1};
+        static const int DY[4] = {-1, 1, 0, 0};
+
+        // an object leaves a placed box room through its entries, next to the box room
+        int boxroom = sim.boxroomObjects[pos.room];
+        if (boxroom >= 0 && sim.rooms[pos.room].entryOn(static_cast<RoomSide>(move), pos.x, pos.y) >= 0) {
+            portal = pos;
+            Pos outside = sim.cellPositions[sim.positions[static_cast<size_t>(boxroom) * sim.count + instance]];
+            return {outside.room, outside.x + DX[move], outside.y + DY[move]};
+        }
+        return {pos.room, pos.x + DX[move], pos.y + DY[move]};
+    }
+
+    bool findEntry(int boxroom_id, Input move, Pos& entry_pos) const
+    {
+        const Room& boxroom = sim.rooms[boxroom_id];
+        int entry = boxroom.firstEntryOn(static_cast<RoomSide>(move ^ 1));
+        if (entry < 0) {
+            return false;
+        }
+        entry_pos = {boxroom_id, boxroom.entries[entry][1], boxroom.entries[entry][0]};
+        return true;
+    }
+
+    int cellKey(Pos pos, Input move) const { return sim.cellOf(pos) * 4 + move; }
+};
+
+BatchSimulator::BatchSimulator(const Level& level, size_t instances, int threads)
+    : count(instances), rooms(level.rooms)
+{
+    // the level's own GamePlay supplies the initial state, targets and Zobrist keys
+    GamePlay reference(level);
+    const GameState& initial = reference.getCurrState();
+
+    for (int room = 0; room < static_cast<int>(rooms.size()); ++room) {
+        roomOffsets.push_back(cells);
+        for (int y = 0; y < rooms[room].size; ++y) {
+            for (int x = 0; x < rooms[room].size; ++x) {
+                cellPositions.push_back({room, x, y});
+                CellKind kind = rooms[room].cellAt(x, y);
+                wallCells.push_back(kind == CELL_WALL || kind == CELL_PORTAL_WALL);
+            }
+        }
+        cells += rooms[room].size * rooms[room].size;
+    }
+    boxTargetCells.assign(cells, 0);
+    for (const auto& target: reference.getBoxDestinations()) {
+        boxTargetCells[cellOf(target)] = 1;
+    }
+    Pos destination = reference.getPlayerDestination();
+    if (destination.room >= 0 && destination.room < static_cast<int>(rooms.size())
+        && destination.x >= 0 && destination.x < rooms[destination.room].size
+        && destination.y >= 0 && destination.y < rooms[destination.room].size) {
+        playerTarget = cellOf(destination);
+    }
+
+    objects.push_back({PLAYER, -1});
+    initialCells.push_back(cellOf(initial.player));
+    for (const auto& [bid, box]: initial.boxes) {
+        if (bid != static_cast<int>(objects.size()) - 1) {
+            throw std::runtime_error("Box ids of the level are not consecutive");
+        }
+        objects.push_back({BOX, bid});
+        initialCells.push_back(cellOf(box));
+    }
+    boxroomObjects.assign(rooms.size(), -1);
+    for (const auto& [rid, boxroom]: initial.boxrooms) {
+        boxroomObjects[rid] = static_cast<int>(objects.size());
+        objects.push_back({BOXROOM, rid});
+        initialCells.push_back(cellOf(boxroom));
+    }
+    if (objects.size() >= UINT16_MAX) {
+        throw std::runtime_error("Level has too many objects for the batch simulator");
+    }
+
+    // where a move leads when no box room entry is involved, for the fast path of stepInstance()
+    static const int DX[4] = {0, 0, -1, 1};
+    static const int DY[4] = {-1, 1, 0, 0};
+    neighbours.resize(static_cast<size_t>(cells) * 4);
+    for (int cell = 0; cell < cells; ++cell) {
+        Pos pos = cellPositions[cell];
+        const Room& room = rooms[pos.room];
+        for (int move = UP; move <= RIGHT; ++move) {
+            int32_t& next = neighbours[cell * 4 + move];
+            int x = pos.x + DX[move];
+            int y = pos.y + DY[move];
+            if (boxroomObjects[pos.room] >= 0 && room.entryOn(static_cast<RoomSide>(move), pos.x, pos.y) >= 0) {
+                next = STEP_PORTAL;
+            }
+            else if (x < 0 || x >= room.size || y < 0 || y >= room.size || wallCells[cellOf({pos.room, x, y})]) {
+                next = STEP_WALL;
+            }
+            else {
+                next = cellOf({pos.room, x, y});
+            }
+        }
+    }
+
+    keys.resize(objects.size() * cells);
+    for (size_t object = 0; object < objects.size(); ++object) {
+        for (int cell = 0; cell < cells; ++cell) {
+            keys[object * cells + cell] = reference.zobristKey(objects[object], cellPositions[cell]);
+        }
+    }
+    initialHash = initial.hash;
+    initialTargets = initial.targets_remaining;
+    initialWin = initial.is_win;
+
+    positions.resize(objects.size() * count);
+    occupancy.resize(count * cells);
+    hashValues.resize(count);
+    targetCounts.resize(count);
+    winFlags.resize(count);
+    movedFlags.resize(count);
+    reset();
+
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    pool = std::make_unique<WorkStealingPool>(threads);
+    workers.resize(threads);
+    for (auto& worker: workers) {
+        worker.scratch.resize(cells);
+    }
+}
+
+BatchSimulator::~BatchSimulator() = default;
+
+void BatchSimulator::reset()
+{
+    for (size_t instance = 0; instance < count; ++instance) {
+        reset(instance);
+    }
+}
+
+void BatchSimulator::reset(size_t instance)
+{
+    uint16_t* grid = occupancy.data() + instance * cells;
+    std::fill(grid, grid + cells, 0);
+    for (size_t object = 0; object < objects.size(); ++object) {
+        positions[object * count + instance] = initialCells[object];
+        grid[initialCells[object]] = static_cast<uint16_t>(object + 1);
+    }
+    hashValues[instance] = initialHash;
+    targetCounts[instance] = initialTargets;
+    winFlags[instance] = initialWin;
+    movedFlags[instance] = 0;
+}
+
+int BatchSimulator::objectOf(Occupant object) const
+{
+    switch (object.type) {
+        case PLAYER: return 0;
+        case BOX: return 1 + object.id;
+        case BOXROOM: return boxroomObjects[object.id];
+        default: return -1;
+    }
+}
+
+void BatchSimulator::step(const Input* inputs)
+{
+    size_t chunks = (count + CHUNK - 1) / CHUNK;
+    pool->run(chunks, [&](int worker, size_t chunk) {
+        size_t begin = chunk * CHUNK;
+        size_t end = std::min(count, begin + CHUNK);
+        for (size_t i = begin; i < end; ++i) {
+            stepInstance(workers[worker], i, inputs[i]);
+        }
+
+        // the win test is branch-free over the arrays, so the compiler can vectorize it
+        const int32_t* player = positions.data();
+        const int32_t* targets = targetCounts.data();
+        uint8_t* wins = winFlags.data();
+        const int32_t destination = playerTarget;
+        for (size_t i = begin; i < end; ++i) {
+            wins[i] = static_cast<uint8_t>((player[i] == destination) & (targets[i] == 0));
+        }
+    });
+}
+
+void BatchSimulator::stepInstance(Worker& worker, size_t instance, Input input)
+{
+    // fast path: the player walks into a wall or onto a free cell, nothing else is involved
+    uint16_t* grid = occupancy.data() + instance * cells;
+    int32_t player = positions[instance];
+    int32_t next = neighbours[player * 4 + input];
+    if (next == STEP_WALL) {
+        movedFlags[instance] = 0;
+        return;
+    }
+    if (next >= 0 && grid[next] == 0) {
+        grid[player] = 0;
+        grid[next] = 1;
+        positions[instance] = next;
+        hashValues[instance] ^= keys[player] ^ keys[next];
+        movedFlags[instance] = 1;
+        return;
+    }
+
+    InstanceView view{*this, instance};
+    if (!resolvePush(view, input, worker.scratch, worker.events)) {
+        movedFlags[instance] = 0;
+        return;
+    }
+    movedFlags[instance] = 1;
+
+    // vacate every source first: in a closed loop an object moves into a cell another one leaves
+    for (const auto& event: worker.events) {
+        grid[cellOf(event.from)] = 0;
+    }
+    uint64_t hash = hashValues[instance];
+    int32_t targets = targetCounts[instance];
+    for (const auto& event: worker.events) {
+        int object = objectOf(event.object);
+        int from = cellOf(event.from);
+        int to = cellOf(event.to);
+        grid[to] = static_cast<uint16_t>(object + 1);
+        positions[static_cast<size_t>(object) * count + instance] = to;
+        hash ^= keys[static_cast<size_t>(object) * cells + from] ^ keys[static_cast<size_t>(object) * cells + to];
+        if (object != 0) {
+            targets += boxTargetCells[from] - boxTargetCells[to];
+        }
+    }
+    hashValues[instance] = hash;
+    targetCounts[instance] = targets;
+}
+
+GameState BatchSimulator::state(size_t instance) const
+{
+    GameState state;
+    for (size_t object = 0; object < objects.size(); ++object) {
+        Pos pos = cellPositions[positions[object * count + instance]];
+        switch (objects[object].type) {
+            case PLAYER: state.player = pos; break;
+            case BOX: state.boxes[objects[object].id] = pos; break;
+            default: state.boxrooms[objects[object].id] = pos; break;
+        }
+    }
+    state.portal_just_passed = std::nullopt;
+    state.hash = hashValues[instance];
+    state.targets_remaining = targetCounts[instance];
+    state.is_win = winFlags[instance] != 0;
+    return state;
+}
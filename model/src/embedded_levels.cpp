@@ -0,0 +1,354 @@
+#include "../include/embedded_levels.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+const int EMBEDDED_MAX_ROOMS = 10;      // box rooms are named by a single digit
+const int EMBEDDED_MAX_SIDE = 16;
+const int EMBEDDED_MAX_ENTRIES = 16;
+const int EMBEDDED_MAX_MARKERS = 32;
+
+/// @brief A level file compiled into the program
+struct EmbeddedSource
+{
+    const char* name;
+    std::string_view text;
+};
+
+#ifdef EMBEDDED_LEVEL_DATA_GENERATED
+#include <embedded_level_data.inc>    // written into the build tree by the CMake build
+#else
+#include "embedded_level_data.inc"    // the copy in src/, for builds without CMake
+#endif
+
+/// @brief Room table of a built-in level, filled at compile time
+struct EmbeddedRoom
+{
+    int size = 0;
+    bool is_box = false;
+    std::array<uint8_t, EMBEDDED_MAX_SIDE * EMBEDDED_MAX_SIDE> cells{};    ///< CellKind, row-major with stride size
+    int entry_count = 0;
+    std::array<std::array<int, 2>, EMBEDDED_MAX_ENTRIES> entries{};
+    int marker_count = 0;
+    std::array<Marker, EMBEDDED_MAX_MARKERS> markers{};
+};
+
+struct EmbeddedLevel
+{
+    int id = 0;
+    int room_count = 0;
+    std::array<EmbeddedRoom, EMBEDDED_MAX_ROOMS> rooms{};
+    const char* error = nullptr;    ///< Why the file could not be parsed, nullptr if it was
+};
+
+/// @brief Minimal JSON reader for the level schema, usable in constant expressions
+/// @details Strings without escapes, non-negative integers, booleans, arrays and objects.
+///          The first error is kept and stops all further reading.
+class JsonCursor
+{
+public:
+    constexpr explicit JsonCursor(std::string_view text) : text(text) {}
+
+    const char* error = nullptr;
+
+    constexpr void fail(const char* message)
+    {
+        if (!error) {
+            error = message;
+        }
+        pos = text.size();
+    }
+
+    constexpr bool consume(char c)
+    {
+        skipSpace();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    constexpr void expect(char c)
+    {
+        if (!consume(c)) {
+            fail("unexpected character");
+        }
+    }
+
+    /// @brief After '[' or '{': whether another element follows, consuming the separator or the closing bracket
+    constexpr bool next(char close, bool first)
+    {
+        if (consume(close)) {
+            return false;
+        }
+        if (!first) {
+            expect(',');
+        }
+        return !error;
+    }
+
+    constexpr std::string_view string()
+    {
+        expect('"');
+        size_t start = pos;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\') {
+                fail("escapes are not supported");
+                return {};
+            }
+            ++pos;
+        }
+        if (pos >= text.size()) {
+            fail("unterminated string");
+            return {};
+        }
+        return text.substr(start, pos++ - start);
+    }
+
+    constexpr int integer()
+    {
+        skipSpace();
+        int value = 0;
+        size_t start = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9' && value < 100000) {
+            value = value * 10 + (text[pos++] - '0');
+        }
+        if (pos == start) {
+            fail("expected a number");
+        }
+        return value;
+    }
+
+    constexpr bool boolean()
+    {
+        skipSpace();
+        if (text.substr(pos, 4) == "true") {
+            pos += 4;
+            return true;
+        }
+        if (text.substr(pos, 5) == "false") {
+            pos += 5;
+            return false;
+        }
+        fail("expected true or false");
+        return false;
+    }
+
+    constexpr bool atEnd()
+    {
+        skipSpace();
+        return pos == text.size();
+    }
+
+private:
+    std::string_view text;
+    size_t pos = 0;
+
+    constexpr void skipSpace()
+    {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+            ++pos;
+        }
+    }
+};
+
+/// @brief Read one element of "rooms", following LevelLoader::parseLevel()
+constexpr void parseRoom(JsonCursor& json, EmbeddedLevel& level)
+{
+    int r_id = -1;
+    EmbeddedRoom room;
+    std::array<uint8_t, EMBEDDED_MAX_SIDE * EMBEDDED_MAX_SIDE> layout{};   // stride EMBEDDED_MAX_SIDE
+    int rows = 0;
+    int columns[EMBEDDED_MAX_SIDE] = {};
+
+    json.expect('{');
+    for (bool first = true; json.next('}', first); first = false) {
+        std::string_view key = json.string();
+        json.expect(':');
+        if (key == "r_id") {
+            r_id = json.integer();
+        }
+        else if (key == "size") {
+            room.size = json.integer();
+        }
+        else if (key == "is_box") {
+            room.is_box = json.boolean();
+        }
+        else if (key == "entries") {
+            json.expect('[');
+            for (bool first_entry = true; json.next(']', first_entry); first_entry = false) {
+                if (room.entry_count == EMBEDDED_MAX_ENTRIES) {
+                    json.fail("too many entries");
+                    return;
+                }
+                json.expect('[');
+                int y = json.integer();
+                json.expect(',');
+                int x = json.integer();
+                json.expect(']');
+                room.entries[room.entry_count++] = {y, x};
+            }
+        }
+        else if (key == "layout") {
+            json.expect('[');
+            for (bool first_row = true; json.next(']', first_row); first_row = false) {
+                if (rows == EMBEDDED_MAX_SIDE) {
+                    json.fail("layout too large to embed");
+                    return;
+                }
+                json.expect('[');
+                for (bool first_cell = true; json.next(']', first_cell); first_cell = false) {
+                    std::string_view cell = json.string();
+                    if (columns[rows] == EMBEDDED_MAX_SIDE || cell.size() != 1) {
+                        json.fail(cell.size() != 1 ? "invalid cell" : "layout too large to embed");
+                        return;
+                    }
+                    layout[rows * EMBEDDED_MAX_SIDE + columns[rows]++] = static_cast<uint8_t>(cell[0]);
+                }
+                ++rows;
+            }
+        }
+        else {
+            json.fail("unknown room key");
+        }
+    }
+    if (json.error) {
+        return;
+    }
+    if (r_id < 0 || r_id >= level.room_count) {
+        json.fail("invalid room ID");
+        return;
+    }
+    if (room.size <= 0 || room.size > EMBEDDED_MAX_SIDE || rows > room.size) {
+        json.fail("layout does not fit the room size");
+        return;
+    }
+
+    // cells missing from a short layout default to walls; movable objects become markers
+    for (int y = 0; y < room.size; ++y) {
+        if (columns[y] > room.size) {
+            json.fail("layout does not fit the room size");
+            return;
+        }
+        for (int x = 0; x < room.size; ++x) {
+            char c = y < rows && x < columns[y] ? static_cast<char>(layout[y * EMBEDDED_MAX_SIDE + x]) : '#';
+            CellKind kind = CELL_FLOOR;
+            switch (c) {
+                case '#': kind = CELL_WALL; break;
+                case '|': kind = CELL_PORTAL_WALL; break;
+                case '=': kind = CELL_PLAYER_TARGET; break;
+                case '_': kind = CELL_BOX_TARGET; break;
+                case '.': break;
+                default: {
+                    bool digit = c >= '0' && c <= '9';
+                    if (c != 'p' && c != 'b' && !digit) {
+                        json.fail("invalid cell");
+                        return;
+                    }
+                    if (room.marker_count == EMBEDDED_MAX_MARKERS) {
+                        json.fail("too many objects to embed");
+                        return;
+                    }
+                    MarkerKind marker = c == 'p' ? MARKER_PLAYER : c == 'b' ? MARKER_BOX : MARKER_BOXROOM;
+                    room.markers[room.marker_count++] = {marker, static_cast<uint8_t>(digit ? c - '0' : 0),
+                                                         static_cast<uint16_t>(x), static_cast<uint16_t>(y)};
+                    break;
+                }
+            }
+            room.cells[y * room.size + x] = kind;
+        }
+    }
+    level.rooms[r_id] = room;
+}
+
+constexpr EmbeddedLevel parseEmbeddedLevel(std::string_view text)
+{
+    EmbeddedLevel level;
+    JsonCursor json(text);
+    json.expect('{');
+    for (bool first = true; json.next('}', first); first = false) {
+        std::string_view key = json.string();
+        json.expect(':');
+        if (key == "l_id") {
+            level.id = json.integer();
+        }
+        else if (key == "room_num") {
+            level.room_count = json.integer();
+            if (level.room_count > EMBEDDED_MAX_ROOMS) {
+                json.fail("too many rooms");
+            }
+        }
+        else if (key == "rooms") {
+            json.expect('[');
+            for (bool first_room = true; json.next(']', first_room); first_room = false) {
+                parseRoom(json, level);
+            }
+        }
+        else {
+            json.fail("unknown level key");
+        }
+    }
+    if (!json.error && !json.atEnd()) {
+        json.fail("trailing characters");
+    }
+    level.error = json.error;
+    return level;
+}
+
+/// @brief The built-in level at an index of EMBEDDED_LEVEL_SOURCES
+/// @details One variable per level, so that each level is parsed in a constant expression of its own
+///          and the compiler's evaluation limit applies per level, not to the whole campaign.
+template <size_t I>
+constexpr EmbeddedLevel EMBEDDED_LEVEL = parseEmbeddedLevel(EMBEDDED_LEVEL_SOURCES[I].text);
+
+template <size_t... I>
+constexpr std::array<const EmbeddedLevel*, sizeof...(I)> embeddedLevelTable(std::index_sequence<I...>)
+{
+    static_assert(((EMBEDDED_LEVEL<I>.error == nullptr) && ...),
+                  "A level listed in model/levels/campaign.txt is not a valid level that can be embedded");
+    return {{&EMBEDDED_LEVEL<I>...}};
+}
+
+constexpr std::array<const EmbeddedLevel*, EMBEDDED_LEVEL_SOURCES.size()> EMBEDDED_LEVELS =
+    embeddedLevelTable(std::make_index_sequence<EMBEDDED_LEVEL_SOURCES.size()>());
+
+} // namespace
+
+std::vector<std::string> embeddedLevelNames()
+{
+    std::vector<std::string> names;
+    for (const auto& source: EMBEDDED_LEVEL_SOURCES) {
+        names.push_back(source.name);
+    }
+    return names;
+}
+
+bool loadEmbeddedLevel(const std::string& name, Level& level)
+{
+    for (size_t i = 0; i < EMBEDDED_LEVELS.size(); ++i) {
+        if (name != EMBEDDED_LEVEL_SOURCES[i].name) {
+            continue;
+        }
+        const EmbeddedLevel& embedded = *EMBEDDED_LEVELS[i];
+        level.id = embedded.id;
+        level.room_num = embedded.room_count;
+        level.rooms.assign(embedded.room_count, Room());
+        for (int r = 0; r < embedded.room_count; ++r) {
+            const EmbeddedRoom& source = embedded.rooms[r];
+            Room& room = level.rooms[r];
+            room.size = source.size;
+            room.is_box = source.is_box;
+            room.scene.assign(source.cells.begin(), source.cells.begin() + source.size * source.size);
+            room.entries.assign(source.entries.begin(), source.entries.begin() + source.entry_count);
+            room.markers.assign(source.markers.begin(), source.markers.begin() + source.marker_count);
+            room.indexEntries();
+        }
+        return true;
+    }
+    return false;
+}
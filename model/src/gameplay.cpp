@@ -1,6 +1,10 @@
 #include "../include/gameplay.hpp"
+#include "../include/push_resolver.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 bool operator== (const Pos& a, const Pos& b)
 {
@@ -17,80 +21,215 @@ GamePlay::GamePlay(const Level level)
     
     int boxid = 0;
 
-    // Find initial positions of player, boxes, and destinations
+    // Find initial positions of player, boxes and box rooms
     for (int room = 0; room < rooms.size(); ++room) {
-        for (int y = 0; y < rooms[room].size && y < MAX_SIZE; ++y) {
-            for (int x = 0; x < rooms[room].size && x < MAX_SIZE; ++x) {
-                std::string cell = rooms[room].scene[y][x];
-                
-                if (cell == "p") {
-                    currState.player = {room, x, y};
-                    rooms[room].scene[y][x] = "."; // Replace player with empty space
-                }
-                else if (cell == "b") {
-                    currState.boxes[boxid] = {room, x, y};
-                    rooms[room].scene[y][x] = "."; // Replace box with empty space
+        for (const auto& marker: rooms[room].markers) {
+            Pos pos = {room, marker.x, marker.y};
+            switch (marker.kind) {
+                case MARKER_PLAYER:
+                    currState.player = pos;
+                    break;
+                case MARKER_BOX:
+                    currState.boxes[boxid] = pos;
                     boxid++;
-                }
-                else if (cell == "=") {
+                    break;
+                case MARKER_BOXROOM:
+                    // box rooms are looked up by room id, so each must name a room and be placed once
+                    if (marker.digit >= rooms.size() || currState.boxrooms.count(marker.digit) != 0) {
+                        throw std::runtime_error("Box room " + std::to_string(marker.digit)
+                                                 + (marker.digit >= rooms.size() ? " is not a room of the level" : " is placed twice"));
+                    }
+                    currState.boxrooms[marker.digit] = pos;
+                    break;
+            }
+        }
+    }
+
+    // Find destinations
+    for (int room = 0; room < rooms.size(); ++room) {
+        for (int y = 0; y < rooms[room].size; ++y) {
+            for (int x = 0; x < rooms[room].size; ++x) {
+                CellKind cell = rooms[room].cellAt(x, y);
+
+                if (cell == CELL_PLAYER_TARGET) {
                     playerDestination = {room, x, y};
                 }
-                else if (cell == "_") {
+                else if (cell == CELL_BOX_TARGET) {
                     boxDestinations.push_back({room, x, y});
                 }
-                else if (cell >= "0" && cell <= "9") {
-                    currState.boxrooms[(cell[0] - '0')] = {room, x, y};
-                    rooms[room].scene[y][x] = "."; // Replace box with empty space
-                }
             }
         }
     }
     
+    // Build the occupancy grid from the initial state
+    occupancy.resize(rooms.size());
+    roomCellOffsets.resize(rooms.size());
+    int cell_count = 0;
+    for (int room = 0; room < rooms.size(); ++room) {
+        occupancy[room].assign(rooms[room].size * rooms[room].size, {SPACE, -1});
+        roomCellOffsets[room] = cell_count;
+        cell_count += rooms[room].size * rooms[room].size;
+    }
+    pushScratch.resize(cell_count);
+
+    // Zobrist keys depend only on the level layout, so every GamePlay of a level hashes alike
+    uint64_t seed = 0x5EED2B0C5A11D1CEull;
+    zobristKeys.resize(static_cast<size_t>(cell_count) * (2 + rooms.size()));
+    for (auto& key: zobristKeys) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        key = z ^ (z >> 31);
+    }
+    currState.hash = hashState(currState);
+
+    boxTargetCells.assign(cell_count, 0);
+    for (const auto& dest: boxDestinations) {
+        boxTargetCells[cellIndex(dest)] = 1;
+    }
+    currState.targets_remaining = countTargetsRemaining(currState);
+
+    occupantAt(currState.player) = {PLAYER, -1};
+    for (const auto& [bid, box]: currState.boxes) {
+        occupantAt(box) = {BOX, bid};
+    }
+    for (const auto& [rid, boxroom]: currState.boxrooms) {
+        occupantAt(boxroom) = {BOXROOM, rid};
+    }
+
+    markDeadSquares();
+    currState.stuck_objects = countStuckObjects(currState);
+    currState.is_deadlocked = checkDeadlock(currState);
+
     nextState = currState;
 }
 
-GameState GamePlay::getCurrState()
+const GameState& GamePlay::getCurrState() const
 {
     return currState;
 }
 
-GameState GamePlay::getNextState()
+const GameState& GamePlay::getNextState() const
 {
     return nextState;
 }
 
-CellType GamePlay::getCellType(Pos pos)
+void GamePlay::setState(const GameState& state)
 {
-    if (rooms[pos.room].scene[pos.y][pos.x] == "#" || rooms[pos.room].scene[pos.y][pos.x] == "|") {
-        return WALL;
+    occupantAt(currState.player) = {SPACE, -1};
+    for (const auto& [bid, box]: currState.boxes) {
+        occupantAt(box) = {SPACE, -1};
     }
-
-    if (currState.player == pos) {
-        return PLAYER;
+    for (const auto& [rid, boxroom]: currState.boxrooms) {
+        occupantAt(boxroom) = {SPACE, -1};
     }
 
+    currState = state;
+    currState.hash = hashState(currState);
+    currState.targets_remaining = countTargetsRemaining(currState);
+    currState.is_win = checkWin(currState);
+    occupantAt(currState.player) = {PLAYER, -1};
     for (const auto& [bid, box]: currState.boxes) {
-        if (box == pos) {
-            return BOX;
-        }
+        occupantAt(box) = {BOX, bid};
     }
-
     for (const auto& [rid, boxroom]: currState.boxrooms) {
-        if (boxroom == pos) {
-            return BOXROOM;
-        }
+        occupantAt(boxroom) = {BOXROOM, rid};
     }
+    currState.stuck_objects = countStuckObjects(currState);
+    currState.is_deadlocked = checkDeadlock(currState);
 
-    return SPACE;
+    moveEvents.clear();
+    movesApplied = true;
+    pendingFrozen = 0;
+    journal.clear();
+    journalEntries.clear();
+    journalPos = 0;
+    nextState = currState;
+}
+
+const std::vector<Room>& GamePlay::getRooms() const
+{
+    return rooms;
+}
+
+Pos GamePlay::getPlayerDestination() const
+{
+    return playerDestination;
+}
+
+const std::vector<Pos>& GamePlay::getBoxDestinations() const
+{
+    return boxDestinations;
+}
+
+bool GamePlay::isDeadSquare(Pos pos) const
+{
+    return isInside(pos) && deadCells[cellIndex(pos)];
+}
+
+bool GamePlay::isInside(Pos pos) const
+{
+    return pos.room >= 0 && pos.room < rooms.size()
+        && pos.x >= 0 && pos.x < rooms[pos.room].size
+        && pos.y >= 0 && pos.y < rooms[pos.room].size;
 }
 
-CellType GamePlay::operateMove(CellType object_to_move, Pos object_curr_pos, Input move)
+Occupant& GamePlay::occupantAt(Pos pos)
 {
-    // base case: unmovable objects
-    if (object_to_move == WALL || object_to_move == SPACE) {
-        return object_to_move;
+    return occupancy[pos.room][pos.y * rooms[pos.room].size + pos.x];
+}
+
+const Occupant& GamePlay::occupantAt(Pos pos) const
+{
+    return occupancy[pos.room][pos.y * rooms[pos.room].size + pos.x];
+}
+
+int GamePlay::cellIndex(Pos pos) const
+{
+    return roomCellOffsets[pos.room] + pos.y * rooms[pos.room].size + pos.x;
+}
+
+int GamePlay::cellKey(Pos pos, Input move) const
+{
+    return cellIndex(pos) * 4 + move;
+}
+
+uint64_t GamePlay::zobristKey(Occupant object, Pos pos) const
+{
+    // boxes are interchangeable and share a key; box rooms are told apart by their id
+    size_t kind = object.type == PLAYER ? 0 : object.type == BOX ? 1 : 2 + object.id;
+    return zobristKeys[cellIndex(pos) * (2 + rooms.size()) + kind];
+}
+
+uint64_t GamePlay::hashState(const GameState& state) const
+{
+    uint64_t hash = zobristKey({PLAYER, -1}, state.player);
+    for (const auto& [bid, box]: state.boxes) {
+        hash ^= zobristKey({BOX, bid}, box);
+    }
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        hash ^= zobristKey({BOXROOM, rid}, boxroom);
+    }
+    return hash;
+}
+
+CellType GamePlay::getCellType(Pos pos) const
+{
+    // Cells outside the room layout behave like walls
+    if (!isInside(pos)) {
+        return WALL;
     }
 
+    CellKind cell = rooms[pos.room].cellAt(pos.x, pos.y);
+    if (cell == CELL_WALL || cell == CELL_PORTAL_WALL) {
+        return WALL;
+    }
+
+    return occupantAt(pos).type;
+}
+
+Pos GamePlay::stepFrom(Pos pos, Input move, std::optional<Pos>& portal) const
+{
     int dx = 0, dy = 0;
     switch (move) {
         case UP: dy = -1; break;
@@ -100,136 +239,582 @@ CellType GamePlay::operateMove(CellType object_to_move, Pos object_curr_pos, Inp
     }
 
     // check if the object goes out from a box-room
-    Pos next_pos;
-    bool is_going_out = false;
-    for (const auto& entry: rooms[object_curr_pos.room].entries) {
-        if ((entry[0] == object_curr_pos.y && entry[1] == object_curr_pos.x)
-            && ((entry[0] == 0 && move == UP)
-                || (entry[0] == rooms[object_curr_pos.room].size - 1 && move == DOWN)
-                || (entry[1] == 0 && move == LEFT)
-                || (entry[1] == rooms[object_curr_pos.room].size - 1 && move == RIGHT)))
-        {
-            Pos boxroom_pos = currState.boxrooms[object_curr_pos.room];
-            next_pos = {boxroom_pos.room, boxroom_pos.x + dx, boxroom_pos.y + dy};
-            nextState.portal_just_passed = std::optional<Pos>(object_curr_pos);
-            is_going_out = true;
-            break;
+    const Room& room = rooms[pos.room];
+    if (room.entryOn(static_cast<RoomSide>(move), pos.x, pos.y) >= 0) {
+        auto boxroom = currState.boxrooms.find(pos.room);
+        if (boxroom != currState.boxrooms.end()) {
+            portal = pos;
+            return {boxroom->second.room, boxroom->second.x + dx, boxroom->second.y + dy};
         }
     }
-    if (!is_going_out) {
-        next_pos = {object_curr_pos.room, object_curr_pos.x + dx, object_curr_pos.y + dy};
+
+    return {pos.room, pos.x + dx, pos.y + dy};
+}
+
+bool GamePlay::findEntry(int boxroom_id, Input move, Pos& entry_pos) const
+{
+    // a move enters through the side opposite to the one it would leave by
+    const Room& boxroom = rooms[boxroom_id];
+    int entry = boxroom.firstEntryOn(static_cast<RoomSide>(move ^ 1));
+    if (entry < 0) {
+        return false;
     }
+    entry_pos = {boxroom_id, boxroom.entries[entry][1], boxroom.entries[entry][0]};
+    return true;
+}
 
-    // try to push the object that occupies next_pos
-    CellType object_to_push = getCellType(next_pos);
-    CellType target_after_push = operateMove(object_to_push, next_pos, move);
+bool GamePlay::resolveMove(Input move, std::vector<MoveEvent>& moves) const
+{
+    return resolvePush(*this, move, pushScratch, moves);
+}
 
-    // the occupying object is a box-room, try to move in
-    if (target_after_push == BOXROOM) {
-        int boxroom_id = 0;
-        for (const auto& [rid, boxroom]: currState.boxrooms) {
-            if (boxroom == next_pos) {
-                boxroom_id = rid;
-                break;
-            }
+void GamePlay::moveEntity(GameState& state, Occupant object, Pos from, Pos to) const
+{
+    switch (object.type)
+    {
+        case PLAYER:
+            state.player = to;
+            break;
+        case BOX:
+            state.boxes[object.id] = to;
+            state.targets_remaining += boxTargetCells[cellIndex(from)] - boxTargetCells[cellIndex(to)];
+            state.stuck_objects += deadCells[cellIndex(to)] - deadCells[cellIndex(from)];
+            break;
+        case BOXROOM:
+            state.boxrooms[object.id] = to;
+            state.targets_remaining += boxTargetCells[cellIndex(from)] - boxTargetCells[cellIndex(to)];
+            state.stuck_objects += deadCells[cellIndex(to)] - deadCells[cellIndex(from)];
+            break;
+        default:
+            return;
+    }
+    state.hash ^= zobristKey(object, from) ^ zobristKey(object, to);
+}
+
+void GamePlay::operate(Input input)
+{
+    // nextState equals currState except for the moves of an operation that was not applied
+    // yet; undo those instead of copying the whole state
+    if (!movesApplied) {
+        for (const auto& move: moveEvents) {
+            moveEntity(nextState, move.object, move.to, move.from);
         }
+        nextState.stuck_objects -= pendingFrozen;
+    }
+    movesApplied = false;
+    pendingFrozen = 0;
+    nextState.portal_just_passed = std::nullopt;
+    
+    if (resolveMove(input, moveEvents)) {
+        for (const auto& move: moveEvents) {
+            moveEntity(nextState, move.object, move.from, move.to);
 
-        bool can_enter = false;
-        for (const auto& entry: rooms[boxroom_id].entries) {
-            if ((move == UP && entry[0] == rooms[boxroom_id].size - 1)
-                || (move == DOWN && entry[0] == 0)
-                || (move == LEFT && entry[1] == rooms[boxroom_id].size - 1)
-                || (move == RIGHT && entry[1] == 0))
-            {
-                can_enter = true;
-                next_pos = {boxroom_id, entry[1], entry[0]};
-                nextState.portal_just_passed = std::optional<Pos>(next_pos);
-                break;
+            // report the player's own portal crossing in preference to a pushed object's
+            if (move.portal.has_value() && (move.object.type == PLAYER || !nextState.portal_just_passed.has_value())) {
+                nextState.portal_just_passed = move.portal;
             }
         }
 
-        // can't enter
-        if (!can_enter) {
-            return object_to_move;
+        // Freeze deadlocks: besides the moved objects, any object whose run of boxes (see
+        // isBlockedOnAxis) reaches a cell that a box entered or left may have become frozen, so
+        // compare the frozen objects among those before and after the move
+        if (!boxDestinations.empty()) {
+            const MoveEvent* first = moveEvents.data();
+            const MoveEvent* last = first + moveEvents.size();
+            freezeCandidates.clear();
+            for (const auto& move: moveEvents) {
+                if (move.object.type != PLAYER) {
+                    freezeCandidates.push_back(move);
+                }
+            }
+            moveOnGrid(first, last, true);
+            for (const auto& move: moveEvents) {
+                if (move.object.type == BOX) {
+                    addFreezeCandidates(move.from);
+                    addFreezeCandidates(move.to);
+                }
+            }
+            for (const auto& candidate: freezeCandidates) {
+                pendingFrozen += isFrozenOffTarget(candidate.to);
+            }
+            moveOnGrid(first, last, false);
+            for (const auto& candidate: freezeCandidates) {
+                pendingFrozen -= isFrozenOffTarget(candidate.from);
+            }
+            nextState.stuck_objects += pendingFrozen;
         }
+    }
+    
+    nextState.is_win = checkWin(nextState);
+    nextState.is_deadlocked = checkDeadlock(nextState);
+}
+
+bool GamePlay::previewMove(Input input, std::vector<MoveEvent>& events) const
+{
+    return resolveMove(input, events);
+}
+
+bool GamePlay::canMove(Input input) const
+{
+    return resolveMove(input, previewScratch);
+}
+
+bool GamePlay::checkWin(const GameState& state) const
+{
+    return state.player == playerDestination && state.targets_remaining == 0;
+}
 
-        // cross the portal and enter
-        CellType new_object_to_push = getCellType(next_pos);
-        target_after_push = operateMove(new_object_to_push, next_pos, move);
+int GamePlay::countTargetsRemaining(const GameState& state) const
+{
+    int covered = 0;
+    for (const auto& [_, box]: state.boxes) {
+        covered += boxTargetCells[cellIndex(box)];
+    }
+    for (const auto& [_, boxroom]: state.boxrooms) {
+        covered += boxTargetCells[cellIndex(boxroom)];
     }
+    return static_cast<int>(boxDestinations.size()) - covered;
+}
 
-    // unable to push the object away from the target
-    if (target_after_push == WALL || target_after_push == BOX || target_after_push == PLAYER) {
-        return object_to_move;
+void GamePlay::markDeadSquares()
+{
+    // A box (or box room) at a cell can be pushed one way if its pusher can stand behind it and the
+    // cell ahead can take it: a floor cell, where it may also enter a box room standing there, or an
+    // entry it leaves its box room through, landing next to that box room wherever it stands.
+    // Live cells, from which a target can be reached this way, grow from the targets to a fixpoint.
+    int cell_count = static_cast<int>(boxTargetCells.size());
+    deadCells.assign(cell_count, 0);
+    if (boxDestinations.empty()) {
+        return;
     }
 
-    // push the object away and move into the target
-    if (target_after_push == SPACE) {
-        switch (object_to_move)
-        {
-            case PLAYER:
-                nextState.player = next_pos;
-                break;
-            case BOX:
-                for (const auto& [bid, box]: currState.boxes) {
-                    if (box == object_curr_pos) {
-                        nextState.boxes[bid] = next_pos;
-                        break;
-                    }
+    std::vector<uint8_t> live = boxTargetCells;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        // entering a box room while moving in a direction lands on its first entry on the opposite side
+        bool enter_live[4] = {false, false, false, false};
+        for (const auto& [rid, boxroom]: currState.boxrooms) {
+            for (int move = UP; move <= RIGHT; ++move) {
+                int entry = rooms[rid].firstEntryOn(static_cast<RoomSide>(move ^ 1));
+                if (entry >= 0 && live[cellIndex({rid, rooms[rid].entries[entry][1], rooms[rid].entries[entry][0]})]) {
+                    enter_live[move] = true;
                 }
-                break;
-            case BOXROOM:
-                for (const auto& [rid, boxroom]: currState.boxrooms) {
-                    if (boxroom == object_curr_pos) {
-                        nextState.boxrooms[rid] = next_pos;
-                        break;
+            }
+        }
+
+        for (int room = 0; room < rooms.size(); ++room) {
+            for (int y = 0; y < rooms[room].size; ++y) {
+                for (int x = 0; x < rooms[room].size; ++x) {
+                    Pos pos = {room, x, y};
+                    if (live[cellIndex(pos)] || getCellType(pos) == WALL) {
+                        continue;
+                    }
+                    for (int move = UP; move <= RIGHT && !live[cellIndex(pos)]; ++move) {
+                        if (!canPassSide(pos, static_cast<Input>(move ^ 1)) || !canPassSide(pos, static_cast<Input>(move))) {
+                            continue;
+                        }
+                        std::optional<Pos> portal;
+                        Pos next = stepFrom(pos, static_cast<Input>(move), portal);
+                        if (portal.has_value() || live[cellIndex(next)] || enter_live[move]) {
+                            live[cellIndex(pos)] = 1;
+                            changed = true;
+                        }
                     }
                 }
-                break;            
+            }
         }
-        return SPACE;
     }
 
+    for (int room = 0; room < rooms.size(); ++room) {
+        for (int y = 0; y < rooms[room].size; ++y) {
+            for (int x = 0; x < rooms[room].size; ++x) {
+                Pos pos = {room, x, y};
+                deadCells[cellIndex(pos)] = getCellType(pos) != WALL && !live[cellIndex(pos)];
+            }
+        }
+    }
 }
 
-void GamePlay::operate(Input input)
+bool GamePlay::canPassSide(Pos pos, Input side) const
 {
-    nextState = currState;
-    nextState.portal_just_passed = std::nullopt;
-    
-    operateMove(PLAYER, currState.player, input);
-    
-    // Check win condition
-    nextState.is_win = (nextState.player == playerDestination);
-    
-    bool all_destinations_exist_box = true;
-    for (const auto& dest: boxDestinations) {
-        bool exist_box = false;
-        for (const auto& [_, box]: nextState.boxes) {
-            if (box == dest) {
-                exist_box = true;
+    // whether an object can move out of pos towards side, or be pushed from there
+    Pos next = pos;
+    switch (side) {
+        case UP: next.y--; break;
+        case DOWN: next.y++; break;
+        case LEFT: next.x--; break;
+        case RIGHT: next.x++; break;
+    }
+    if (isInside(next)) {
+        CellKind cell = rooms[next.room].cellAt(next.x, next.y);
+        return cell != CELL_WALL && cell != CELL_PORTAL_WALL;
+    }
+    return rooms[pos.room].entryOn(static_cast<RoomSide>(side), pos.x, pos.y) >= 0
+        && currState.boxrooms.count(pos.room) != 0;
+}
+
+bool GamePlay::isFrozen(Pos pos) const
+{
+    return isBlockedOnAxis(pos, true) && isBlockedOnAxis(pos, false);
+}
+
+bool GamePlay::isBlockedOnAxis(Pos pos, bool horizontal) const
+{
+    // Objects are pushed in chains, so a neighbouring box only blocks together with the whole
+    // run of boxes along the axis. The object can never move along the axis if a wall is next
+    // to it, or if its run of boxes ends at a wall and every box of the run is walled in across
+    // the axis (so the run can neither shift nor lose a box; boxes joining it keep it stuck).
+    // A box room or an entry ends a run without blocking it, since objects may enter or leave.
+    const Input sides[2] = {horizontal ? LEFT : UP, horizontal ? RIGHT : DOWN};
+    const Input across[2] = {horizontal ? UP : LEFT, horizontal ? DOWN : RIGHT};
+    auto walledIn = [&](Pos cell, const Input (&dirs)[2]) {
+        return !canPassSide(cell, dirs[0]) || !canPassSide(cell, dirs[1]);
+    };
+
+    if (walledIn(pos, sides)) {
+        return true;
+    }
+    if (!walledIn(pos, across)) {
+        return false;
+    }
+    for (Input side: sides) {
+        Pos cell = pos;
+        while (true) {
+            if (!canPassSide(cell, side)) {
+                return true;
+            }
+            std::optional<Pos> portal;
+            Pos next = stepFrom(cell, side, portal);
+            if (portal.has_value() || occupantAt(next).type != BOX || !walledIn(next, across)) {
                 break;
             }
+            cell = next;
         }
-        if (!exist_box) {
-            for (const auto& [_, boxroom]: nextState.boxrooms) {
-                if (boxroom == dest) {
-                    exist_box = true;
-                    break;
-                }
+    }
+    return false;
+}
+
+bool GamePlay::isFrozenOffTarget(Pos pos) const
+{
+    // objects on dead squares are counted as stuck by moveEntity() already
+    int cell = cellIndex(pos);
+    return !boxDestinations.empty() && !deadCells[cell] && !boxTargetCells[cell] && isFrozen(pos);
+}
+
+void GamePlay::addFreezeCandidates(Pos cell)
+{
+    // Walk from the cell along each side the way isBlockedOnAxis walks towards it: through boxes
+    // walled in across the axis, up to the first object that does not continue the run
+    for (int side = UP; side <= RIGHT; ++side) {
+        const Input across[2] = {side <= DOWN ? LEFT : UP, side <= DOWN ? RIGHT : DOWN};
+        Pos at = cell;
+        while (canPassSide(at, static_cast<Input>(side))) {
+            std::optional<Pos> portal;
+            Pos next = stepFrom(at, static_cast<Input>(side), portal);
+            const Occupant& object = occupantAt(next);
+            if (portal.has_value() || (object.type != BOX && object.type != BOXROOM)) {
+                break;
+            }
+            auto known = std::find_if(freezeCandidates.begin(), freezeCandidates.end(), [&](const MoveEvent& candidate) {
+                return candidate.object.type == object.type && candidate.object.id == object.id;
+            });
+            if (known == freezeCandidates.end()) {
+                freezeCandidates.push_back({object, next, next, std::nullopt});
+            }
+            if (object.type != BOX || (canPassSide(next, across[0]) && canPassSide(next, across[1]))) {
+                break;
             }
+            at = next;
         }
+    }
+}
 
-        if (!exist_box) {
-            all_destinations_exist_box = false;
-            break;
-        }
+int GamePlay::countStuckObjects(const GameState& state) const
+{
+    // expects the occupancy grid to mirror state
+    int stuck = 0;
+    auto count = [&](Pos pos) {
+        stuck += deadCells[cellIndex(pos)] + isFrozenOffTarget(pos);
+    };
+    for (const auto& [bid, box]: state.boxes) {
+        count(box);
     }
-    
-    nextState.is_win = nextState.is_win && all_destinations_exist_box;
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        count(boxroom);
+    }
+    return stuck;
+}
+
+bool GamePlay::checkDeadlock(const GameState& state) const
+{
+    int objects = static_cast<int>(state.boxes.size() + state.boxrooms.size());
+    return objects - state.stuck_objects < static_cast<int>(boxDestinations.size());
+}
+
+const std::vector<MoveEvent>& GamePlay::getMoveEvents() const
+{
+    return moveEvents;
 }
 
 void GamePlay::updateState()
 {
-    currState = nextState;
+    if (movesApplied) {
+        return;
+    }
+
+    moveOnGrid(moveEvents.data(), moveEvents.data() + moveEvents.size(), true);
+    for (const auto& move: moveEvents) {
+        moveEntity(currState, move.object, move.from, move.to);
+    }
+    movesApplied = true;
+
+    currState.portal_just_passed = nextState.portal_just_passed;
+    currState.is_win = nextState.is_win;
+    currState.stuck_objects += pendingFrozen;
+    currState.is_deadlocked = nextState.is_deadlocked;
+
+    if (!moveEvents.empty()) {
+        // a new move invalidates the undone ones
+        if (journalPos < journalEntries.size()) {
+            journal.resize(journalEntries[journalPos].first);
+            journalEntries.resize(journalPos);
+        }
+        journalEntries.push_back({journal.size(), moveEvents.size(), currState.portal_just_passed, pendingFrozen});
+        journal.insert(journal.end(), moveEvents.begin(), moveEvents.end());
+        journalPos++;
+    }
+}
+
+void GamePlay::discardPendingMoves()
+{
+    if (!movesApplied) {
+        for (const auto& move: moveEvents) {
+            moveEntity(nextState, move.object, move.to, move.from);
+        }
+        nextState.stuck_objects -= pendingFrozen;
+        movesApplied = true;
+    }
+    moveEvents.clear();
+    pendingFrozen = 0;
+}
+
+void GamePlay::moveOnGrid(const MoveEvent* first, const MoveEvent* last, bool forward)
+{
+    // Vacate every source cell first, so that a chain of pushes does not overwrite
+    // an entity that moved into a vacated cell
+    for (const MoveEvent* move = first; move != last; ++move) {
+        occupantAt(forward ? move->from : move->to) = {SPACE, -1};
+    }
+    for (const MoveEvent* move = first; move != last; ++move) {
+        occupantAt(forward ? move->to : move->from) = move->object;
+    }
+}
+
+void GamePlay::applyJournalEntry(const JournalEntry& entry, bool forward)
+{
+    const MoveEvent* first = journal.data() + entry.first;
+    const MoveEvent* last = first + entry.count;
+
+    moveOnGrid(first, last, forward);
+    for (const MoveEvent* move = first; move != last; ++move) {
+        Pos from = forward ? move->from : move->to;
+        Pos to = forward ? move->to : move->from;
+        moveEntity(currState, move->object, from, to);
+        moveEntity(nextState, move->object, from, to);
+    }
+
+    currState.portal_just_passed = forward ? entry.portal : std::nullopt;
+    currState.stuck_objects += forward ? entry.frozen : -entry.frozen;
+    currState.is_win = checkWin(currState);
+    currState.is_deadlocked = checkDeadlock(currState);
+    nextState.portal_just_passed = currState.portal_just_passed;
+    nextState.stuck_objects = currState.stuck_objects;
+    nextState.is_win = currState.is_win;
+    nextState.is_deadlocked = currState.is_deadlocked;
+}
+
+bool GamePlay::canUndo() const
+{
+    return journalPos > 0;
+}
+
+bool GamePlay::canRedo() const
+{
+    return journalPos < journalEntries.size();
+}
+
+bool GamePlay::undo()
+{
+    if (!canUndo()) {
+        return false;
+    }
+    discardPendingMoves();
+    applyJournalEntry(journalEntries[--journalPos], false);
+    return true;
+}
+
+bool GamePlay::redo()
+{
+    if (!canRedo()) {
+        return false;
+    }
+    discardPendingMoves();
+    const JournalEntry& entry = journalEntries[journalPos++];
+    applyJournalEntry(entry, true);
+    moveEvents.assign(journal.begin() + entry.first, journal.begin() + entry.first + entry.count);
+    return true;
+}
+
+int GamePlay::rewind(int moves)
+{
+    int undone = 0;
+    while (undone < moves && undo()) {
+        undone++;
+    }
+    return undone;
+}
+
+int GamePlay::getMoveCount() const
+{
+    return static_cast<int>(journalPos);
+}
+
+void GamePlay::saveSession(GameSession& session) const
+{
+    session.state = currState;
+    session.journal.assign(journal.begin(), journal.end());
+    session.entries.assign(journalEntries.begin(), journalEntries.end());
+    session.position = journalPos;
+}
+
+void GamePlay::restoreSession(const GameSession& session)
+{
+    auto reject = [](const std::string& what) {
+        return std::runtime_error("Saved game does not fit the level: " + what);
+    };
+    auto isKnown = [&](Occupant object) {
+        switch (object.type) {
+            case PLAYER: return object.id == -1;
+            case BOX: return currState.boxes.count(object.id) > 0;
+            case BOXROOM: return currState.boxrooms.count(object.id) > 0;
+            default: return false;
+        }
+    };
+    auto isFloor = [&](Pos pos) {
+        if (!isInside(pos)) {
+            return false;
+        }
+        CellKind cell = rooms[pos.room].cellAt(pos.x, pos.y);
+        return cell != CELL_WALL && cell != CELL_PORTAL_WALL;
+    };
+
+    // the level's objects, each on a floor cell of its own
+    const GameState& state = session.state;
+    if (state.boxes.size() != currState.boxes.size() || state.boxrooms.size() != currState.boxrooms.size()) {
+        throw reject("different objects");
+    }
+    std::vector<int> cells = {isFloor(state.player) ? cellIndex(state.player) : -1};
+    for (const auto& [bid, box]: state.boxes) {
+        if (!isKnown({BOX, bid})) {
+            throw reject("unknown box " + std::to_string(bid));
+        }
+        cells.push_back(isFloor(box) ? cellIndex(box) : -1);
+    }
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        if (!isKnown({BOXROOM, rid})) {
+            throw reject("unknown box room " + std::to_string(rid));
+        }
+        cells.push_back(isFloor(boxroom) ? cellIndex(boxroom) : -1);
+    }
+    std::sort(cells.begin(), cells.end());
+    if (cells.front() < 0 || std::adjacent_find(cells.begin(), cells.end()) != cells.end()) {
+        throw reject("an object outside the floor or sharing a cell");
+    }
+    if (state.portal_just_passed.has_value() && !isInside(*state.portal_just_passed)) {
+        throw reject("portal outside the rooms");
+    }
+
+    // journal entries cover the events back to back; events move known objects between cells of the level
+    size_t next = 0;
+    for (const auto& entry: session.entries) {
+        if (entry.first != next || entry.count > session.journal.size() - next
+            || (entry.portal.has_value() && !isInside(*entry.portal))) {
+            throw reject("malformed journal");
+        }
+        next += entry.count;
+    }
+    if (next != session.journal.size() || session.position > session.entries.size()) {
+        throw reject("malformed journal");
+    }
+    for (const auto& event: session.journal) {
+        if (!isKnown(event.object) || !isFloor(event.from) || !isFloor(event.to)
+            || (event.portal.has_value() && !isInside(*event.portal))) {
+            throw reject("malformed journal");
+        }
+    }
+
+    // every event must start where the object stands: walk the journal back to its first move,
+    // then forward to its last one
+    GameState walk = state;
+    auto positionOf = [&](Occupant object) -> Pos& {
+        return object.type == PLAYER ? walk.player : object.type == BOX ? walk.boxes[object.id] : walk.boxrooms[object.id];
+    };
+    size_t applied = session.position > 0 ? session.entries[session.position - 1].first + session.entries[session.position - 1].count : 0;
+    for (size_t e = applied; e-- > 0;) {
+        Pos& pos = positionOf(session.journal[e].object);
+        if (!(pos == session.journal[e].to)) {
+            throw reject("journal does not lead to the state");
+        }
+        pos = session.journal[e].from;
+    }
+    for (const auto& event: session.journal) {
+        Pos& pos = positionOf(event.object);
+        if (!(pos == event.from)) {
+            throw reject("journal does not lead to the state");
+        }
+        pos = event.to;
+    }
+
+    setState(state);
+    journal = session.journal;
+    journalEntries = session.entries;
+    journalPos = session.position;
+
+    // Like the hash and the win and deadlock flags, the journal's frozen deltas are derived from the
+    // positions, so recount them along the journal rather than trusting the saved ones.
+    for (size_t i = journalPos; i-- > 0;) {
+        const MoveEvent* first = journal.data() + journalEntries[i].first;
+        const MoveEvent* last = first + journalEntries[i].count;
+        moveOnGrid(first, last, false);
+        for (const MoveEvent* move = first; move != last; ++move) {
+            moveEntity(currState, move->object, move->to, move->from);
+        }
+    }
+    currState.stuck_objects = countStuckObjects(currState);
+    for (auto& entry: journalEntries) {
+        const MoveEvent* first = journal.data() + entry.first;
+        const MoveEvent* last = first + entry.count;
+        moveOnGrid(first, last, true);
+        for (const MoveEvent* move = first; move != last; ++move) {
+            moveEntity(currState, move->object, move->from, move->to);
+        }
+        int stuck = countStuckObjects(currState);
+        entry.frozen = stuck - currState.stuck_objects;
+        currState.stuck_objects = stuck;
+    }
+    for (size_t i = journalEntries.size(); i > journalPos; --i) {
+        const JournalEntry& entry = journalEntries[i - 1];
+        const MoveEvent* first = journal.data() + entry.first;
+        const MoveEvent* last = first + entry.count;
+        moveOnGrid(first, last, false);
+        for (const MoveEvent* move = first; move != last; ++move) {
+            moveEntity(currState, move->object, move->to, move->from);
+        }
+        currState.stuck_objects -= entry.frozen;
+    }
+    currState.portal_just_passed = state.portal_just_passed;
+    currState.is_deadlocked = checkDeadlock(currState);
+    nextState = currState;
 }
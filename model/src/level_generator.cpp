@@ -0,0 +1,498 @@
+#include "../include/level_generator.hpp"
+#include "../include/gameplay.hpp"
+#include "../include/solver.hpp"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/// @brief Seeded random numbers that do not depend on the standard library's distributions
+class Random
+{
+public:
+    explicit Random(uint64_t seed) : engine(seed) {}
+
+    /// @brief Uniform integer in [0, n)
+    int below(int n) { return static_cast<int>(engine() % static_cast<uint64_t>(n)); }
+
+    /// @brief Uniform integer in [low, high]
+    int between(int low, int high) { return low + below(high - low + 1); }
+
+    /// @brief True with probability p
+    bool chance(double p) { return static_cast<double>(engine() >> 11) * (1.0 / 9007199254740992.0) < p; }
+
+    template <typename T>
+    void shuffle(std::vector<T>& items)
+    {
+        for (size_t i = items.size(); i > 1; --i) {
+            std::swap(items[i - 1], items[below(static_cast<int>(i))]);
+        }
+    }
+
+private:
+    std::mt19937_64 engine;
+};
+
+/// @brief Shapes the main room is built from
+enum RoomTemplate
+{
+    TEMPLATE_OPEN,       ///< Walls only on the border
+    TEMPLATE_PILLARS,    ///< Some of the cells on a 2x2 lattice are walls
+    TEMPLATE_DIVIDED,    ///< A wall line across the room, with one or two gaps
+    TEMPLATE_NOTCHED,    ///< A walled block in one corner
+    TEMPLATE_COUNT
+};
+
+const int STEP_X[4] = {0, 0, -1, 1};    // indexed by Input
+const int STEP_Y[4] = {-1, 1, 0, 0};
+
+const double MAIN_WALL_DENSITY = 0.08;      // chance of an extra wall on a free cell of the main room
+const double BOXROOM_WALL_DENSITY = 0.15;   // same inside the box room
+const double PULL_CHANCE = 0.75;            // chance that a reverse move tries pulling first
+
+Pos step(Pos pos, int move)
+{
+    return {pos.room, pos.x + STEP_X[move], pos.y + STEP_Y[move]};
+}
+
+bool isInside(const Level& level, Pos pos)
+{
+    const Room& room = level.rooms[pos.room];
+    return pos.x >= 0 && pos.y >= 0 && pos.x < room.size && pos.y < room.size;
+}
+
+bool isOpen(const Level& level, Pos pos)
+{
+    if (!isInside(level, pos)) {
+        return false;
+    }
+    CellKind cell = level.rooms[pos.room].cellAt(pos.x, pos.y);
+    return cell != CELL_WALL && cell != CELL_PORTAL_WALL;
+}
+
+void setCell(Room& room, int x, int y, CellKind kind)
+{
+    room.scene[y * room.size + x] = kind;
+}
+
+/// @brief A room of the given size with walls all around its border
+Room makeRoom(int size, bool is_box)
+{
+    Room room;
+    room.size = size;
+    room.is_box = is_box;
+    room.scene.assign(static_cast<size_t>(size) * size, CELL_FLOOR);
+    for (int i = 0; i < size; ++i) {
+        setCell(room, i, 0, CELL_WALL);
+        setCell(room, i, size - 1, CELL_WALL);
+        setCell(room, 0, i, CELL_WALL);
+        setCell(room, size - 1, i, CELL_WALL);
+    }
+    return room;
+}
+
+void applyTemplate(Room& room, RoomTemplate shape, Random& random)
+{
+    int size = room.size;
+    switch (shape) {
+        case TEMPLATE_PILLARS:
+            for (int y = 2; y < size - 2; y += 2) {
+                for (int x = 2; x < size - 2; x += 2) {
+                    if (random.chance(0.6)) {
+                        setCell(room, x, y, CELL_WALL);
+                    }
+                }
+            }
+            break;
+        case TEMPLATE_DIVIDED: {
+            bool vertical = random.chance(0.5);
+            int line = random.between(2, size - 3);
+            for (int i = 1; i < size - 1; ++i) {
+                setCell(room, vertical ? line : i, vertical ? i : line, CELL_WALL);
+            }
+            int gaps = random.between(1, 2);
+            for (int g = 0; g < gaps; ++g) {
+                int i = random.between(1, size - 2);
+                setCell(room, vertical ? line : i, vertical ? i : line, CELL_FLOOR);
+            }
+            break;
+        }
+        case TEMPLATE_NOTCHED: {
+            int width = random.between(1, (size - 2) / 2);
+            int height = random.between(1, (size - 2) / 2);
+            int x0 = random.chance(0.5) ? 1 : size - 1 - width;
+            int y0 = random.chance(0.5) ? 1 : size - 1 - height;
+            for (int y = y0; y < y0 + height; ++y) {
+                for (int x = x0; x < x0 + width; ++x) {
+                    setCell(room, x, y, CELL_WALL);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/// @brief Turn some interior floor cells into walls, except the protected ones
+void scatterWalls(Room& room, double density, const std::vector<uint8_t>& keep, Random& random)
+{
+    for (int y = 1; y < room.size - 1; ++y) {
+        for (int x = 1; x < room.size - 1; ++x) {
+            if (room.cellAt(x, y) == CELL_FLOOR && !keep[y * room.size + x] && random.chance(density)) {
+                setCell(room, x, y, CELL_WALL);
+            }
+        }
+    }
+}
+
+/// @brief Whether all non-wall cells of a room are connected
+bool isConnected(const Room& room)
+{
+    std::vector<uint8_t> seen(room.scene.size(), 0);
+    std::vector<int> stack;
+    int open_cells = 0;
+    for (int i = 0; i < static_cast<int>(room.scene.size()); ++i) {
+        if (room.scene[i] != CELL_WALL) {
+            ++open_cells;
+            if (stack.empty()) {
+                stack.push_back(i);
+                seen[i] = 1;
+            }
+        }
+    }
+
+    int reached = 0;
+    while (!stack.empty()) {
+        int cell = stack.back();
+        stack.pop_back();
+        ++reached;
+        int x = cell % room.size;
+        int y = cell / room.size;
+        for (int move = UP; move <= RIGHT; ++move) {
+            int nx = x + STEP_X[move];
+            int ny = y + STEP_Y[move];
+            if (nx < 0 || ny < 0 || nx >= room.size || ny >= room.size) {
+                continue;
+            }
+            int next = ny * room.size + nx;
+            if (!seen[next] && room.scene[next] != CELL_WALL) {
+                seen[next] = 1;
+                stack.push_back(next);
+            }
+        }
+    }
+    return open_cells > 0 && reached == open_cells;
+}
+
+/// @brief Interior floor cells of a room, shuffled
+std::vector<Pos> freeCells(const Level& level, int r_id, Random& random)
+{
+    const Room& room = level.rooms[r_id];
+    std::vector<Pos> cells;
+    for (int y = 1; y < room.size - 1; ++y) {
+        for (int x = 1; x < room.size - 1; ++x) {
+            if (room.cellAt(x, y) == CELL_FLOOR) {
+                cells.push_back({r_id, x, y});
+            }
+        }
+    }
+    random.shuffle(cells);
+    return cells;
+}
+
+/// @brief Lay out the rooms and targets of a level, with every object on its target
+/// @return False if the templates left too little room
+bool buildSolvedLevel(const GeneratorOptions& options, Random& random, Level& level, GameState& solved)
+{
+    level.id = 0;
+    level.rooms.clear();
+
+    Room main_room = makeRoom(random.between(options.min_size, options.max_size), false);
+    applyTemplate(main_room, static_cast<RoomTemplate>(random.below(TEMPLATE_COUNT)), random);
+    scatterWalls(main_room, MAIN_WALL_DENSITY, std::vector<uint8_t>(main_room.scene.size(), 0), random);
+    if (!isConnected(main_room)) {
+        return false;
+    }
+    main_room.indexEntries();
+    level.rooms.push_back(std::move(main_room));
+
+    bool has_boxroom = random.chance(options.boxroom_chance);
+    if (has_boxroom) {
+        // openings in the middle of one or two sides, with the cells just inside them kept free
+        Room box_room = makeRoom(random.chance(0.5) ? 5 : 7, true);
+        int mid = box_room.size / 2;
+        std::vector<uint8_t> keep(box_room.scene.size(), 0);
+        std::vector<int> sides = {SIDE_TOP, SIDE_BOTTOM, SIDE_LEFT, SIDE_RIGHT};
+        random.shuffle(sides);
+        int entry_count = random.between(1, 2);
+        for (int i = 0; i < entry_count; ++i) {
+            int x = sides[i] == SIDE_LEFT ? 0 : sides[i] == SIDE_RIGHT ? box_room.size - 1 : mid;
+            int y = sides[i] == SIDE_TOP ? 0 : sides[i] == SIDE_BOTTOM ? box_room.size - 1 : mid;
+            setCell(box_room, x, y, CELL_FLOOR);
+            box_room.entries.push_back({y, x});
+            keep[(y - STEP_Y[sides[i]]) * box_room.size + (x - STEP_X[sides[i]])] = 1;
+        }
+        scatterWalls(box_room, BOXROOM_WALL_DENSITY, keep, random);
+        if (!isConnected(box_room)) {
+            return false;
+        }
+        box_room.indexEntries();
+        level.rooms.push_back(std::move(box_room));
+    }
+    level.room_num = static_cast<int>(level.rooms.size());
+
+    int boxes = random.between(options.min_boxes, options.max_boxes);
+    std::vector<Pos> main_cells = freeCells(level, 0, random);
+    std::vector<Pos> inner_cells = has_boxroom ? freeCells(level, 1, random) : std::vector<Pos>();
+    if (static_cast<int>(main_cells.size()) < boxes + 4) {
+        return false;
+    }
+
+    solved = GameState();
+    solved.is_win = true;
+    solved.player = main_cells.back();
+    main_cells.pop_back();
+    setCell(level.rooms[0], solved.player.x, solved.player.y, CELL_PLAYER_TARGET);
+
+    for (int b = 0; b < boxes; ++b) {
+        std::vector<Pos>& cells = (b == 0 && !inner_cells.empty() && random.chance(0.5)) ? inner_cells : main_cells;
+        Pos target = cells.back();
+        cells.pop_back();
+        setCell(level.rooms[target.room], target.x, target.y, CELL_BOX_TARGET);
+        solved.boxes[b] = target;
+    }
+
+    if (has_boxroom) {
+        Pos pos = main_cells.back();
+        main_cells.pop_back();
+        if (random.chance(0.5)) {
+            setCell(level.rooms[0], pos.x, pos.y, CELL_BOX_TARGET);
+        }
+        solved.boxrooms[1] = pos;
+    }
+    return true;
+}
+
+/// @brief Whether an object of a state stands on a cell
+bool isOccupied(const GameState& state, Pos pos)
+{
+    if (state.player == pos) {
+        return true;
+    }
+    for (const auto& [bid, box]: state.boxes) {
+        if (box == pos) {
+            return true;
+        }
+    }
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        if (boxroom == pos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Move the object standing on 'from' to 'to'; false if there is none
+bool moveObject(GameState& state, Pos from, Pos to)
+{
+    for (auto& [bid, box]: state.boxes) {
+        if (box == from) {
+            box = to;
+            return true;
+        }
+    }
+    for (auto& [rid, boxroom]: state.boxrooms) {
+        if (boxroom == from) {
+            boxroom = to;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief A possible predecessor of a state
+struct ReverseMove
+{
+    GameState state;    ///< State before the move
+    bool pull;          ///< Whether the move pushed an object
+};
+
+/// @brief The states from which moving the player one step in a direction may lead to a state
+/// @details Candidates only: a move through box room entries can end in several places, so the
+///          caller confirms each of them with GamePlay.
+void reverseCandidates(const Level& level, const GameState& state, int move, std::vector<ReverseMove>& candidates)
+{
+    candidates.clear();
+    Pos player = state.player;
+    int back = move ^ 1;
+
+    // where the player came from: the previous cell, the cell before the box room it entered,
+    // or an entry of the box room it left
+    std::vector<Pos> starts;
+    starts.push_back(step(player, back));
+    auto inside = state.boxrooms.find(player.room);
+    if (inside != state.boxrooms.end() && level.rooms[player.room].entryOn(static_cast<RoomSide>(back), player.x, player.y) >= 0) {
+        starts.push_back(step(inside->second, back));
+    }
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        if (step(boxroom, move) == player) {
+            for (const auto& entry: level.rooms[rid].entries) {
+                if (level.rooms[rid].entryOn(static_cast<RoomSide>(move), entry[1], entry[0]) >= 0) {
+                    starts.push_back({rid, entry[1], entry[0]});
+                }
+            }
+        }
+    }
+
+    // what the player may have pushed: the object ahead, one that went into the box room ahead,
+    // or one that left the player's room through the entry the player stands on
+    std::vector<Pos> pushed;
+    Pos ahead = step(player, move);
+    if (isInside(level, ahead)) {
+        pushed.push_back(ahead);
+        for (const auto& [rid, boxroom]: state.boxrooms) {
+            if (boxroom == ahead) {
+                for (const auto& entry: level.rooms[rid].entries) {
+                    if (level.rooms[rid].entryOn(static_cast<RoomSide>(back), entry[1], entry[0]) >= 0) {
+                        pushed.push_back({rid, entry[1], entry[0]});
+                    }
+                }
+            }
+        }
+    }
+    if (inside != state.boxrooms.end() && level.rooms[player.room].entryOn(static_cast<RoomSide>(move), player.x, player.y) >= 0) {
+        pushed.push_back(step(inside->second, move));
+    }
+
+    for (const Pos& start: starts) {
+        if (!isOpen(level, start) || isOccupied(state, start)) {
+            continue;
+        }
+        GameState plain = state;
+        plain.player = start;
+        plain.portal_just_passed = std::nullopt;
+        candidates.push_back({plain, false});
+        for (const Pos& from: pushed) {
+            GameState pulled = plain;
+            if (moveObject(pulled, from, player)) {
+                candidates.push_back({pulled, true});
+            }
+        }
+    }
+}
+
+/// @brief Whether an object stands on a target, which the level format cannot express
+bool coversTarget(const Level& level, const GameState& state)
+{
+    auto onTarget = [&](Pos pos) { return level.rooms[pos.room].cellAt(pos.x, pos.y) != CELL_FLOOR; };
+    if (onTarget(state.player)) {
+        return true;
+    }
+    for (const auto& [bid, box]: state.boxes) {
+        if (onTarget(box)) {
+            return true;
+        }
+    }
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        if (onTarget(boxroom)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Replace the markers of a level with the objects of a state
+void placeMarkers(Level& level, const GameState& state)
+{
+    for (auto& room: level.rooms) {
+        room.markers.clear();
+    }
+    auto place = [&](Pos pos, MarkerKind kind, int digit) {
+        level.rooms[pos.room].markers.push_back({kind, static_cast<uint8_t>(digit), static_cast<uint16_t>(pos.x), static_cast<uint16_t>(pos.y)});
+    };
+    place(state.player, MARKER_PLAYER, 0);
+    for (const auto& [bid, box]: state.boxes) {
+        place(box, MARKER_BOX, 0);
+    }
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        place(boxroom, MARKER_BOXROOM, rid);
+    }
+}
+
+} // namespace
+
+bool generateLevel(const GeneratorOptions& options, uint64_t seed, GeneratedLevel& result)
+{
+    Random random(seed);
+    Level level;
+    GameState solved;
+    if (!buildSolvedLevel(options, random, level, solved)) {
+        return false;
+    }
+
+    // walk backwards from the solved configuration; every state reached can be solved by
+    // replaying the walk forwards, so only its difficulty remains to be checked
+    placeMarkers(level, solved);
+    GamePlay game(level);
+    GameState state = game.getCurrState();
+    std::vector<ReverseMove> candidates;
+    for (int i = 0; i < 2 * options.scramble_moves; ++i) {
+        if (i >= options.scramble_moves && !coversTarget(level, state)) {
+            break;
+        }
+        int move = random.below(4);
+        reverseCandidates(level, state, move, candidates);
+        random.shuffle(candidates);
+        if (random.chance(PULL_CHANCE)) {
+            std::stable_partition(candidates.begin(), candidates.end(),
+                                  [](const ReverseMove& candidate) { return candidate.pull; });
+        }
+        for (const auto& candidate: candidates) {
+            game.setState(candidate.state);
+            game.operate(static_cast<Input>(move));
+            if (!game.getMoveEvents().empty() && game.getNextState().hash == state.hash) {
+                state = game.getCurrState();
+                break;
+            }
+        }
+    }
+    if (coversTarget(level, state) || state.is_win) {
+        return false;
+    }
+
+    placeMarkers(level, state);
+    SolverOptions solver_options;
+    solver_options.threads = 1;
+    solver_options.max_states = options.max_states;
+    solver_options.table_bytes = options.table_bytes;
+    SolveResult solution = solve(level, solver_options);
+    int length = static_cast<int>(solution.moves.size());
+    if (!solution.solved || length < options.min_moves || length > options.max_moves) {
+        return false;
+    }
+
+    // branching: moves that change the state, averaged over the states of the solution
+    GamePlay replay(level);
+    int choices = 0;
+    for (Input move: solution.moves) {
+        for (int m = UP; m <= RIGHT; ++m) {
+            choices += replay.canMove(static_cast<Input>(m));
+        }
+        replay.operate(move);
+        replay.updateState();
+    }
+    double branching = static_cast<double>(choices) / length;
+    if (branching < options.min_branching || branching > options.max_branching) {
+        return false;
+    }
+
+    result.level = std::move(level);
+    result.moves = length;
+    result.branching = branching;
+    result.states = solution.states;
+    return true;
+}
@@ -1,19 +1,238 @@
 #include "../include/level_loader.hpp"
+#include "../include/asset_archive.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
 #include <stdexcept>
 
+namespace {
+
+CellKind parseCell(const std::string& cell, int x, int y, std::vector<Marker>& markers)
+{
+    if (cell.size() == 1) {
+        char c = cell[0];
+        switch (c) {
+            case '#': return CELL_WALL;
+            case '|': return CELL_PORTAL_WALL;
+            case '=': return CELL_PLAYER_TARGET;
+            case '_': return CELL_BOX_TARGET;
+            case '.': return CELL_FLOOR;
+            case 'p':
+                markers.push_back({MARKER_PLAYER, 0, static_cast<uint16_t>(x), static_cast<uint16_t>(y)});
+                return CELL_FLOOR;
+            case 'b':
+                markers.push_back({MARKER_BOX, 0, static_cast<uint16_t>(x), static_cast<uint16_t>(y)});
+                return CELL_FLOOR;
+            default:
+                if (c >= '0' && c <= '9') {
+                    markers.push_back({MARKER_BOXROOM, static_cast<uint8_t>(c - '0'), static_cast<uint16_t>(x), static_cast<uint16_t>(y)});
+                    return CELL_FLOOR;
+                }
+                break;
+        }
+    }
+    throw std::runtime_error("Invalid cell \"" + cell + "\" at (" + std::to_string(x) + ", " + std::to_string(y) + ")");
+}
+
+/// @brief The layout string of a cell of a room, taking the markers standing on it into account
+std::string cellText(const Room& room, int r_id, int x, int y)
+{
+    CellKind kind = room.cellAt(x, y);
+    for (const auto& marker: room.markers) {
+        if (marker.x != x || marker.y != y) {
+            continue;
+        }
+        if (kind != CELL_FLOOR) {
+            throw std::runtime_error("Marker on a non-floor cell at (" + std::to_string(x) + ", " + std::to_string(y)
+                                     + ") of room " + std::to_string(r_id) + " cannot be written");
+        }
+        switch (marker.kind) {
+            case MARKER_PLAYER: return "p";
+            case MARKER_BOX: return "b";
+            case MARKER_BOXROOM: return std::string(1, static_cast<char>('0' + marker.digit));
+        }
+    }
+    switch (kind) {
+        case CELL_WALL: return "#";
+        case CELL_PORTAL_WALL: return "|";
+        case CELL_PLAYER_TARGET: return "=";
+        case CELL_BOX_TARGET: return "_";
+        default: return ".";
+    }
+}
+
+/*
+ * Binary level file (.ppl). Little-endian; offsets count from the start of the file.
+ *   LevelFileHeader
+ *   LevelFileRoom[room_count]
+ *   then per room: size * size CellKind bytes, entry_count BinaryEntry, marker_count Marker
+ */
+const char LEVEL_FILE_MAGIC[4] = {'P', 'P', 'L', 'V'};
+
+struct LevelFileHeader
+{
+    char magic[4];           // LEVEL_FILE_MAGIC
+    uint16_t version;        // LevelLoader::BINARY_VERSION
+    uint16_t room_count;
+    int32_t level_id;
+    uint32_t file_size;
+    uint64_t source_hash;    // LevelLoader::sourceHash() of the JSON it was compiled from, 0 if none
+};
+
+struct LevelFileRoom
+{
+    uint32_t cells_offset;
+    uint32_t entries_offset;
+    uint32_t markers_offset;
+    uint16_t size;
+    uint16_t entry_count;
+    uint16_t marker_count;
+    uint8_t is_box;
+    uint8_t reserved;
+};
+
+struct BinaryEntry
+{
+    uint16_t y;
+    uint16_t x;
+};
+
+static_assert(sizeof(LevelFileHeader) == 24 && sizeof(LevelFileRoom) == 20 && sizeof(BinaryEntry) == 4
+              && sizeof(Marker) == 6, "binary level records must not be padded");
+
+/// @brief Build a level from the bytes of a binary level file, checking every record against the file size
+Level parseBinaryLevel(const uint8_t* data, size_t size, const std::string& level_path)
+{
+    auto invalid = [&](const std::string& what) {
+        return std::runtime_error("Invalid binary level file " + level_path + ": " + what);
+    };
+    LevelFileHeader header;
+    if (size < sizeof(header)) {
+        throw invalid("truncated header");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, LEVEL_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw invalid("bad magic");
+    }
+    if (header.version != LevelLoader::BINARY_VERSION) {
+        throw invalid("unsupported version " + std::to_string(header.version));
+    }
+    if (header.file_size != size || sizeof(header) + static_cast<size_t>(header.room_count) * sizeof(LevelFileRoom) > size) {
+        throw invalid("truncated file");
+    }
+
+    Level level;
+    level.id = header.level_id;
+    level.room_num = header.room_count;
+    level.rooms.resize(header.room_count);
+    for (int r = 0; r < header.room_count; ++r) {
+        LevelFileRoom record;
+        std::memcpy(&record, data + sizeof(header) + r * sizeof(LevelFileRoom), sizeof(record));
+        size_t cells = static_cast<size_t>(record.size) * record.size;
+        if (record.size == 0
+            || record.cells_offset + cells > size
+            || record.entries_offset + static_cast<size_t>(record.entry_count) * sizeof(BinaryEntry) > size
+            || record.markers_offset + static_cast<size_t>(record.marker_count) * sizeof(Marker) > size) {
+            throw invalid("room " + std::to_string(r) + " lies outside the file");
+        }
+
+        Room& room = level.rooms[r];
+        room.size = record.size;
+        room.is_box = record.is_box != 0;
+        const uint8_t* scene = data + record.cells_offset;
+        room.scene.assign(scene, scene + cells);
+        if (std::any_of(room.scene.begin(), room.scene.end(), [](uint8_t cell) { return cell > CELL_BOX_TARGET; })) {
+            throw invalid("unknown cell kind in room " + std::to_string(r));
+        }
+
+        room.entries.resize(record.entry_count);
+        for (int e = 0; e < record.entry_count; ++e) {
+            BinaryEntry entry;
+            std::memcpy(&entry, data + record.entries_offset + e * sizeof(BinaryEntry), sizeof(entry));
+            room.entries[e] = {entry.y, entry.x};
+        }
+        room.markers.resize(record.marker_count);
+        if (record.marker_count > 0) {
+            std::memcpy(room.markers.data(), data + record.markers_offset, record.marker_count * sizeof(Marker));
+        }
+        for (const auto& marker: room.markers) {
+            if (marker.kind > MARKER_BOXROOM || marker.x >= room.size || marker.y >= room.size
+                || (marker.kind == MARKER_BOXROOM && marker.digit >= header.room_count)) {
+                throw invalid("bad marker in room " + std::to_string(r));
+            }
+        }
+        room.indexEntries();
+    }
+    return level;
+}
+
+} // namespace
+
+void Room::indexEntries()
+{
+    entryLookup.assign(static_cast<size_t>(4) * size, -1);
+    sideEntries.fill(-1);
+
+    // an entry in a corner lies on two sides; the first entry listed wins a side
+    for (int i = 0; i < entries.size(); ++i) {
+        for (int side = SIDE_TOP; side <= SIDE_RIGHT; ++side) {
+            bool horizontal = side == SIDE_TOP || side == SIDE_BOTTOM;
+            int across = horizontal ? entries[i][0] : entries[i][1];
+            int along = horizontal ? entries[i][1] : entries[i][0];
+            int edge = (side == SIDE_TOP || side == SIDE_LEFT) ? 0 : size - 1;
+            if (across != edge || along < 0 || along >= size) {
+                continue;
+            }
+            if (entryLookup[side * size + along] < 0) {
+                entryLookup[side * size + along] = static_cast<int16_t>(i);
+            }
+            if (sideEntries[side] < 0) {
+                sideEntries[side] = static_cast<int16_t>(i);
+            }
+        }
+    }
+}
+
 Level LevelLoader::loadLevel(const std::string& level_path)
 {
-    std::ifstream file(level_path);
-    if (!file.is_open()) {
+    std::string binary_path = binaryPath(level_path);
+    if (binary_path == level_path) {
+        return loadBinaryLevel(level_path);
+    }
+
+    // a level shipped only in compiled form is loaded as such
+    AssetData text = Assets::read(level_path);
+    if (!text) {
+        AssetData compiled = Assets::read(binary_path);
+        if (compiled) {
+            return parseBinaryLevel(compiled.data(), compiled.size(), binary_path);
+        }
         throw std::runtime_error("Cannot open level file: " + level_path);
     }
 
-    json j;
-    file >> j;
-    file.close();
+    // a compiled copy of exactly this text skips the JSON parse; a stale or broken one is ignored
+    AssetData compiled = Assets::read(binary_path);
+    if (compiled && compiled.size() >= sizeof(LevelFileHeader)) {
+        LevelFileHeader header;
+        std::memcpy(&header, compiled.data(), sizeof(header));
+        if (header.source_hash != 0 && header.source_hash == sourceHash(text.text())) {
+            try {
+                return parseBinaryLevel(compiled.data(), compiled.size(), binary_path);
+            }
+            catch (const std::runtime_error&) {
+            }
+        }
+    }
+    return parseLevel(text.text());
+}
+
+Level LevelLoader::parseLevel(std::string_view text)
+{
+    json j = json::parse(text.begin(), text.end());
 
     Level loaded_level;
     loaded_level.id = j["l_id"];
@@ -29,21 +248,27 @@ Level LevelLoader::loadLevel(const std::string& level_path)
             throw std::runtime_error("Invalid room ID: " + std::to_string(r_id));
         }
 
-        // Initialize scene with empty strings
-        Scene room_scene;
-        for (int i = 0; i < MAX_SIZE; ++i) {
-            for (int j = 0; j < MAX_SIZE; ++j) {
-                room_scene[i][j] = "#"; // Fill with walls by default
-            }
+        // Cells missing from a short layout default to walls
+        const auto& layout = room_json["layout"];
+        if (size <= 0 || layout.size() > static_cast<size_t>(size)) {
+            throw std::runtime_error("Layout of room " + std::to_string(r_id) + " does not fit its size");
         }
+        Scene room_scene(static_cast<size_t>(size) * size, CELL_WALL);
 
-        // Load the actual layout
-        const auto& layout = room_json["layout"];
-        for (int i = 0; i < size && i < MAX_SIZE; ++i) {
-            for (int j = 0; j < size && j < MAX_SIZE; ++j) {
-                if (i < layout.size() && j < layout[i].size()) {
-                    room_scene[i][j] = layout[i][j];
-                }
+        // Load the actual layout, splitting movable objects into markers
+        for (int i = 0; i < layout.size(); ++i) {
+            if (layout[i].size() > static_cast<size_t>(size)) {
+                throw std::runtime_error("Layout of room " + std::to_string(r_id) + " does not fit its size");
+            }
+            for (int j = 0; j < layout[i].size(); ++j) {
+                const std::string& cell = layout[i][j].get_ref<const std::string&>();
+                room_scene[i * size + j] = parseCell(cell, j, i, loaded_level.rooms[r_id].markers);
+            }
+        }
+        for (const auto& marker: loaded_level.rooms[r_id].markers) {
+            if (marker.kind == MARKER_BOXROOM && marker.digit >= loaded_level.room_num) {
+                throw std::runtime_error("Box room " + std::to_string(marker.digit) + " in room " + std::to_string(r_id)
+                                         + " is not a room of the level");
             }
         }
 
@@ -53,8 +278,138 @@ Level LevelLoader::loadLevel(const std::string& level_path)
             std::array<int, 2> lentry = {entry[0], entry[1]};
             loaded_level.rooms[r_id].entries.push_back(lentry);
         }
-        loaded_level.rooms[r_id].scene = room_scene;
+        loaded_level.rooms[r_id].scene = std::move(room_scene);
+        loaded_level.rooms[r_id].indexEntries();
     }
 
     return loaded_level;
 }
+
+Level LevelLoader::loadBinaryLevel(const std::string& level_path)
+{
+    AssetData file = Assets::read(level_path);
+    if (!file) {
+        throw std::runtime_error("Cannot open level file: " + level_path);
+    }
+    return parseBinaryLevel(file.data(), file.size(), level_path);
+}
+
+void LevelLoader::saveBinaryLevel(const Level& level, const std::string& level_path, uint64_t source_hash)
+{
+    LevelFileHeader header;
+    std::memcpy(header.magic, LEVEL_FILE_MAGIC, sizeof(header.magic));
+    header.version = BINARY_VERSION;
+    header.room_count = static_cast<uint16_t>(level.rooms.size());
+    header.level_id = level.id;
+    header.source_hash = source_hash;
+
+    // rooms' records first, then their cells, entries and markers back to back
+    std::vector<LevelFileRoom> records(level.rooms.size());
+    size_t offset = sizeof(header) + records.size() * sizeof(LevelFileRoom);
+    for (size_t r = 0; r < level.rooms.size(); ++r) {
+        const Room& room = level.rooms[r];
+        LevelFileRoom& record = records[r];
+        record = {};
+        record.size = static_cast<uint16_t>(room.size);
+        record.is_box = room.is_box;
+        record.entry_count = static_cast<uint16_t>(room.entries.size());
+        record.marker_count = static_cast<uint16_t>(room.markers.size());
+        record.cells_offset = static_cast<uint32_t>(offset);
+        offset += room.scene.size();
+        record.entries_offset = static_cast<uint32_t>(offset);
+        offset += room.entries.size() * sizeof(BinaryEntry);
+        record.markers_offset = static_cast<uint32_t>(offset);
+        offset += room.markers.size() * sizeof(Marker);
+    }
+    header.file_size = static_cast<uint32_t>(offset);
+
+    std::vector<uint8_t> bytes(offset);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + sizeof(header), records.data(), records.size() * sizeof(LevelFileRoom));
+    for (size_t r = 0; r < level.rooms.size(); ++r) {
+        const Room& room = level.rooms[r];
+        std::memcpy(bytes.data() + records[r].cells_offset, room.scene.data(), room.scene.size());
+        for (size_t e = 0; e < room.entries.size(); ++e) {
+            BinaryEntry entry = {static_cast<uint16_t>(room.entries[e][0]), static_cast<uint16_t>(room.entries[e][1])};
+            std::memcpy(bytes.data() + records[r].entries_offset + e * sizeof(BinaryEntry), &entry, sizeof(entry));
+        }
+        if (!room.markers.empty()) {
+            std::memcpy(bytes.data() + records[r].markers_offset, room.markers.data(), room.markers.size() * sizeof(Marker));
+        }
+    }
+
+    std::ofstream file(level_path, std::ios::binary);
+    if (!file.is_open() || !file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size())) {
+        throw std::runtime_error("Cannot write level file: " + level_path);
+    }
+}
+
+std::string LevelLoader::compileLevel(const std::string& level_path)
+{
+    std::ifstream file(level_path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open level file: " + level_path);
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string binary_path = binaryPath(level_path);
+    if (binary_path == level_path) {
+        throw std::runtime_error("Level file is already compiled: " + level_path);
+    }
+    saveBinaryLevel(parseLevel(text), binary_path, sourceHash(text));
+    return binary_path;
+}
+
+std::string LevelLoader::binaryPath(const std::string& level_path)
+{
+    size_t slash = level_path.find_last_of("/\\");
+    size_t dot = level_path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return level_path + ".ppl";
+    }
+    return level_path.substr(0, dot) + ".ppl";
+}
+
+uint64_t LevelLoader::sourceHash(std::string_view text)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (unsigned char c: text) {
+        hash = (hash ^ c) * 0x100000001B3ull;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+void LevelLoader::saveLevel(const Level& level, const std::string& level_path)
+{
+    std::string text = "{\n";
+    text += "    \"l_id\": " + std::to_string(level.id) + ",\n";
+    text += "    \"room_num\": " + std::to_string(level.rooms.size()) + ",\n";
+    text += "    \"rooms\": [\n";
+    for (size_t r = 0; r < level.rooms.size(); ++r) {
+        const Room& room = level.rooms[r];
+        text += "        {\n";
+        text += "            \"r_id\": " + std::to_string(r) + ",\n";
+        text += "            \"size\": " + std::to_string(room.size) + ",\n";
+        text += std::string("            \"is_box\": ") + (room.is_box ? "true" : "false") + ",\n";
+        text += "            \"entries\": [";
+        for (size_t e = 0; e < room.entries.size(); ++e) {
+            text += (e ? ",[" : "[") + std::to_string(room.entries[e][0]) + ", " + std::to_string(room.entries[e][1]) + "]";
+        }
+        text += "],\n";
+        text += "            \"layout\": [\n";
+        for (int y = 0; y < room.size; ++y) {
+            text += "                [";
+            for (int x = 0; x < room.size; ++x) {
+                text += (x ? ", \"" : "\"") + cellText(room, static_cast<int>(r), x, y) + "\"";
+            }
+            text += y + 1 < room.size ? "],\n" : "]\n";
+        }
+        text += "            ]\n";
+        text += r + 1 < level.rooms.size() ? "        },\n" : "        }\n";
+    }
+    text += "    ]\n}\n";
+
+    std::ofstream file(level_path);
+    if (!file.is_open() || !(file << text)) {
+        throw std::runtime_error("Cannot write level file: " + level_path);
+    }
+}
@@ -0,0 +1,205 @@
+#include "../include/parabox_env.h"
+#include "../include/batch_simulator.hpp"
+#include "../include/level_loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ParaboxEnv
+{
+    std::unique_ptr<BatchSimulator> batch;
+    int threads = 0;
+    uint32_t rooms = 0;
+    uint32_t size = 0;                  ///< Side of the observation planes (largest room)
+    std::vector<uint8_t> staticPlanes;  ///< Observation of one game with only walls and targets set
+    std::vector<Input> inputs;          ///< Actions of the current step, converted
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+int32_t fail(int32_t code, const std::string& message)
+{
+    lastError = message;
+    return code;
+}
+
+size_t planeOffset(const ParaboxEnv& env, int room, int channel)
+{
+    return (static_cast<size_t>(room) * PARABOX_CHANNEL_COUNT + channel) * env.size * env.size;
+}
+
+/// @brief Load a level into an environment, keeping the environment unchanged on failure
+int32_t loadLevel(ParaboxEnv& env, const char* level_path, size_t envs)
+{
+    try {
+        Level level = LevelLoader::loadLevel(level_path);
+        auto batch = std::make_unique<BatchSimulator>(level, envs, env.threads);
+
+        uint32_t size = 0;
+        for (const auto& room: level.rooms) {
+            size = std::max(size, static_cast<uint32_t>(room.size));
+        }
+
+        // walls and targets never move, so they are laid out once and copied for every game
+        env.rooms = static_cast<uint32_t>(level.rooms.size());
+        env.size = size;
+        env.staticPlanes.assign(static_cast<size_t>(env.rooms) * PARABOX_CHANNEL_COUNT * size * size, 0);
+        for (int r = 0; r < static_cast<int>(level.rooms.size()); ++r) {
+            const Room& room = level.rooms[r];
+            uint8_t* wall = env.staticPlanes.data() + planeOffset(env, r, PARABOX_CHANNEL_WALL);
+            uint8_t* box_target = env.staticPlanes.data() + planeOffset(env, r, PARABOX_CHANNEL_BOX_TARGET);
+            uint8_t* player_target = env.staticPlanes.data() + planeOffset(env, r, PARABOX_CHANNEL_PLAYER_TARGET);
+            std::fill(wall, wall + size * size, 1);
+            for (int y = 0; y < room.size; ++y) {
+                for (int x = 0; x < room.size; ++x) {
+                    CellKind cell = room.cellAt(x, y);
+                    wall[y * size + x] = cell == CELL_WALL || cell == CELL_PORTAL_WALL;
+                    box_target[y * size + x] = cell == CELL_BOX_TARGET;
+                    player_target[y * size + x] = cell == CELL_PLAYER_TARGET;
+                }
+            }
+        }
+
+        env.batch = std::move(batch);
+        env.inputs.assign(envs, UP);
+        return PARABOX_OK;
+    }
+    catch (const std::exception& e) {
+        return fail(PARABOX_ERROR_LEVEL, e.what());
+    }
+}
+
+} // namespace
+
+uint32_t parabox_abi_version(void)
+{
+    return PARABOX_ABI_VERSION;
+}
+
+const char* parabox_last_error(void)
+{
+    return lastError.c_str();
+}
+
+ParaboxEnv* parabox_create(const char* level_path, uint32_t envs, int32_t threads)
+{
+    if (!level_path || envs == 0) {
+        fail(PARABOX_ERROR_INVALID_ARGUMENT, "level_path must be set and envs positive");
+        return nullptr;
+    }
+    auto env = std::make_unique<ParaboxEnv>();
+    env->threads = threads;
+    if (loadLevel(*env, level_path, envs) != PARABOX_OK) {
+        return nullptr;
+    }
+    return env.release();
+}
+
+void parabox_destroy(ParaboxEnv* env)
+{
+    delete env;
+}
+
+int32_t parabox_reset(ParaboxEnv* env, const char* level_path)
+{
+    if (!env) {
+        return fail(PARABOX_ERROR_INVALID_ARGUMENT, "env is null");
+    }
+    if (level_path) {
+        return loadLevel(*env, level_path, env->batch->size());
+    }
+    env->batch->reset();
+    return PARABOX_OK;
+}
+
+int32_t parabox_reset_one(ParaboxEnv* env, uint32_t index)
+{
+    if (!env || index >= env->batch->size()) {
+        return fail(PARABOX_ERROR_INVALID_ARGUMENT, "env is null or index out of range");
+    }
+    env->batch->reset(index);
+    return PARABOX_OK;
+}
+
+int32_t parabox_step(ParaboxEnv* env, const uint8_t* actions, uint8_t* moved, uint8_t* won)
+{
+    if (!env || !actions) {
+        return fail(PARABOX_ERROR_INVALID_ARGUMENT, "env and actions must not be null");
+    }
+    size_t count = env->batch->size();
+    for (size_t i = 0; i < count; ++i) {
+        if (actions[i] > RIGHT) {
+            return fail(PARABOX_ERROR_INVALID_ARGUMENT, "action " + std::to_string(actions[i]) + " of game "
+                        + std::to_string(i) + " is not 0-3");
+        }
+        env->inputs[i] = static_cast<Input>(actions[i]);
+    }
+
+    env->batch->step(env->inputs.data());
+    if (moved) {
+        std::memcpy(moved, env->batch->moved(), count);
+    }
+    if (won) {
+        std::memcpy(won, env->batch->wins(), count);
+    }
+    return PARABOX_OK;
+}
+
+int32_t parabox_observation_shape(const ParaboxEnv* env, ParaboxObservationShape* shape)
+{
+    if (!env || !shape) {
+        return fail(PARABOX_ERROR_INVALID_ARGUMENT, "env and shape must not be null");
+    }
+    shape->envs = static_cast<uint32_t>(env->batch->size());
+    shape->rooms = env->rooms;
+    shape->channels = PARABOX_CHANNEL_COUNT;
+    shape->size = env->size;
+    shape->bytes = env->batch->size() * env->staticPlanes.size();
+    return PARABOX_OK;
+}
+
+int32_t parabox_get_observation(const ParaboxEnv* env, uint8_t* buffer, size_t buffer_size)
+{
+    if (!env || !buffer) {
+        return fail(PARABOX_ERROR_INVALID_ARGUMENT, "env and buffer must not be null");
+    }
+    const BatchSimulator& batch = *env->batch;
+    size_t per_env = env->staticPlanes.size();
+    if (buffer_size < batch.size() * per_env) {
+        return fail(PARABOX_ERROR_BUFFER_TOO_SMALL, "observation needs " + std::to_string(batch.size() * per_env) + " bytes");
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        std::memcpy(buffer + i * per_env, env->staticPlanes.data(), per_env);
+    }
+
+    // then mark the objects, reading each object's positions in all games in one pass
+    for (int object = 0; object < batch.objectCount(); ++object) {
+        Occupant occupant = batch.objectOccupant(object);
+        int channel = occupant.type == PLAYER ? PARABOX_CHANNEL_PLAYER
+                    : occupant.type == BOX ? PARABOX_CHANNEL_BOX
+                    : PARABOX_CHANNEL_BOXROOM;
+        uint8_t value = occupant.type == BOXROOM ? static_cast<uint8_t>(occupant.id + 1) : 1;
+        const int32_t* cells = batch.objectCells(object);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Pos pos = batch.cellPos(cells[i]);
+            buffer[i * per_env + planeOffset(*env, pos.room, channel) + pos.y * env->size + pos.x] = value;
+        }
+    }
+    return PARABOX_OK;
+}
+
+int32_t parabox_get_hashes(const ParaboxEnv* env, uint64_t* hashes)
+{
+    if (!env || !hashes) {
+        return fail(PARABOX_ERROR_INVALID_ARGUMENT, "env and hashes must not be null");
+    }
+    std::memcpy(hashes, env->batch->hashes(), env->batch->size() * sizeof(uint64_t));
+    return PARABOX_OK;
+}
@@ -0,0 +1,169 @@
+#include "../include/replay.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+const char REPLAY_MAGIC[4] = {'P', 'P', 'R', 'P'};
+const uint16_t REPLAY_VERSION = 1;
+
+void putInt(std::string& out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+void putVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/// @brief Bounds-checked cursor over the bytes of a replay file
+struct Reader
+{
+    const std::string& data;
+    const std::string& path;
+    size_t pos = 0;
+
+    void need(size_t bytes) const
+    {
+        if (data.size() - pos < bytes) {
+            throw std::runtime_error("Truncated replay file: " + path);
+        }
+    }
+
+    uint64_t getInt(int bytes)
+    {
+        need(bytes);
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos++])) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t getVarint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            need(1);
+            uint8_t byte = static_cast<uint8_t>(data[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Invalid replay file: " + path);
+    }
+};
+
+} // namespace
+
+void ReplayFile::save(const std::string& path, const Replay& replay)
+{
+    std::string out(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    putInt(out, REPLAY_VERSION, 2);
+    putVarint(out, replay.level.size());
+    out += replay.level;
+    putInt(out, replay.start_hash, 8);
+    putInt(out, replay.end_hash, 8);
+    putVarint(out, replay.events.size());
+
+    // times are stored as deltas, which fit in one or two bytes at interactive input rates
+    uint32_t last_time = 0;
+    for (const auto& event: replay.events) {
+        putVarint(out, event.time_ms - last_time);
+        out.push_back(static_cast<char>((event.action << 4) | (event.value & 0x0F)));
+        last_time = event.time_ms;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(out.data(), static_cast<std::streamsize>(out.size()))) {
+        throw std::runtime_error("Cannot write replay file: " + path);
+    }
+}
+
+Replay ReplayFile::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open replay file: " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Reader in{data, path};
+    in.need(sizeof(REPLAY_MAGIC));
+    if (data.compare(0, sizeof(REPLAY_MAGIC), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+        throw std::runtime_error("Not a replay file: " + path);
+    }
+    in.pos = sizeof(REPLAY_MAGIC);
+    uint64_t version = in.getInt(2);
+    if (version != REPLAY_VERSION) {
+        throw std::runtime_error("Unsupported replay version " + std::to_string(version) + ": " + path);
+    }
+
+    Replay replay;
+    uint64_t level_length = in.getVarint();
+    in.need(level_length);
+    replay.level = data.substr(in.pos, level_length);
+    in.pos += level_length;
+    replay.start_hash = in.getInt(8);
+    replay.end_hash = in.getInt(8);
+
+    // every event takes at least two bytes, which bounds the count before reserving
+    uint64_t count = in.getVarint();
+    in.need(count * 2);
+    replay.events.reserve(count);
+    uint32_t time = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        time += static_cast<uint32_t>(in.getVarint());
+        uint8_t packed = static_cast<uint8_t>(in.getInt(1));
+        ReplayEvent event{time, static_cast<ReplayAction>(packed >> 4), static_cast<uint8_t>(packed & 0x0F)};
+        if (event.action > REPLAY_ROTATE_CAMERA || (event.action == REPLAY_MOVE && event.value > RIGHT)) {
+            throw std::runtime_error("Invalid event " + std::to_string(i) + " in replay file: " + path);
+        }
+        replay.events.push_back(event);
+    }
+    return replay;
+}
+
+ReplayResult playReplay(GamePlay& game, const GameState& start, const Replay& replay)
+{
+    ReplayResult result;
+    game.setState(start);
+    result.start_matches = game.getCurrState().hash == replay.start_hash;
+
+    for (const auto& event: replay.events) {
+        switch (event.action) {
+        case REPLAY_MOVE:
+            game.operate(static_cast<Input>(event.value));
+            game.updateState();
+            break;
+        case REPLAY_UNDO:
+            game.undo();
+            break;
+        case REPLAY_REDO:
+            game.redo();
+            break;
+        case REPLAY_RESTART:
+            game.rewind(game.getMoveCount());
+            break;
+        case REPLAY_ROTATE_CAMERA:
+            continue;
+        }
+        result.moves++;
+    }
+
+    const GameState& end = game.getCurrState();
+    result.end_hash = end.hash;
+    result.end_matches = end.hash == replay.end_hash;
+    result.is_win = end.is_win;
+    return result;
+}
@@ -0,0 +1,271 @@
+#include "../include/session.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+const char SESSION_MAGIC[4] = {'P', 'P', 'S', 'V'};
+
+void putInt(std::string& out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+void putVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/// @brief Signed values are zigzag-encoded, so that small negative ones stay short
+void putSigned(std::string& out, int value)
+{
+    putVarint(out, (static_cast<uint64_t>(static_cast<int64_t>(value)) << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63));
+}
+
+void putPos(std::string& out, Pos pos)
+{
+    putSigned(out, pos.room);
+    putSigned(out, pos.x);
+    putSigned(out, pos.y);
+}
+
+void putOptionalPos(std::string& out, const std::optional<Pos>& pos)
+{
+    out.push_back(pos.has_value() ? 1 : 0);
+    if (pos.has_value()) {
+        putPos(out, *pos);
+    }
+}
+
+/// @brief Bounds-checked cursor over the bytes of a save file
+struct Reader
+{
+    const std::string& data;
+    const std::string& path;
+    size_t end;
+    size_t pos = 0;
+
+    void need(uint64_t bytes) const
+    {
+        if (end - pos < bytes) {
+            throw std::runtime_error("Truncated save file: " + path);
+        }
+    }
+
+    uint64_t getInt(int bytes)
+    {
+        need(bytes);
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos++])) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t getVarint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            need(1);
+            uint8_t byte = static_cast<uint8_t>(data[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Invalid save file: " + path);
+    }
+
+    int getSigned()
+    {
+        uint64_t value = getVarint();
+        int64_t decoded = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        if (decoded < INT32_MIN || decoded > INT32_MAX) {
+            throw std::runtime_error("Invalid save file: " + path);
+        }
+        return static_cast<int>(decoded);
+    }
+
+    Pos getPos()
+    {
+        Pos pos;
+        pos.room = getSigned();
+        pos.x = getSigned();
+        pos.y = getSigned();
+        return pos;
+    }
+
+    std::optional<Pos> getOptionalPos()
+    {
+        uint64_t present = getInt(1);
+        if (present > 1) {
+            throw std::runtime_error("Invalid save file: " + path);
+        }
+        return present ? std::optional<Pos>(getPos()) : std::nullopt;
+    }
+
+    /// @brief A count of records that take at least min_bytes each, bounded by the bytes left
+    size_t getCount(size_t min_bytes)
+    {
+        uint64_t count = getVarint();
+        need(count);
+        need(count * min_bytes);
+        return static_cast<size_t>(count);
+    }
+};
+
+} // namespace
+
+void SessionFile::save(const std::string& path, const SavedSession& session)
+{
+    const GameState& state = session.game.state;
+    std::string out(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+    putInt(out, VERSION, 2);
+    putVarint(out, session.level.size());
+    out += session.level;
+    putSigned(out, session.level_id);
+    putInt(out, session.start_hash, 8);
+    uint32_t yaw_bits;
+    std::memcpy(&yaw_bits, &session.camera_yaw, sizeof(yaw_bits));
+    putInt(out, yaw_bits, 4);
+
+    putPos(out, state.player);
+    putVarint(out, state.boxes.size());
+    for (const auto& [bid, box]: state.boxes) {
+        putSigned(out, bid);
+        putPos(out, box);
+    }
+    putVarint(out, state.boxrooms.size());
+    for (const auto& [rid, boxroom]: state.boxrooms) {
+        putSigned(out, rid);
+        putPos(out, boxroom);
+    }
+    putOptionalPos(out, state.portal_just_passed);
+    putInt(out, state.hash, 8);
+
+    // the moves' first events follow from their counts, as the events are stored back to back
+    putVarint(out, session.game.journal.size());
+    for (const auto& event: session.game.journal) {
+        out.push_back(static_cast<char>(event.object.type));
+        putSigned(out, event.object.id);
+        putPos(out, event.from);
+        putPos(out, event.to);
+        putOptionalPos(out, event.portal);
+    }
+    putVarint(out, session.game.entries.size());
+    for (const auto& entry: session.game.entries) {
+        putVarint(out, entry.count);
+        putOptionalPos(out, entry.portal);
+        putSigned(out, entry.frozen);
+    }
+    putVarint(out, session.game.position);
+    putInt(out, LevelLoader::sourceHash(out), 8);
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary);
+        if (!file.write(out.data(), static_cast<std::streamsize>(out.size())) || !file.flush()) {
+            throw std::runtime_error("Cannot write save file: " + path);
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::filesystem::remove(temp_path, error);
+        throw std::runtime_error("Cannot write save file: " + path);
+    }
+}
+
+SavedSession SessionFile::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open save file: " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(SESSION_MAGIC) || data.compare(0, sizeof(SESSION_MAGIC), SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0) {
+        throw std::runtime_error("Not a save file: " + path);
+    }
+    if (data.size() < sizeof(SESSION_MAGIC) + 2 + 8) {
+        throw std::runtime_error("Truncated save file: " + path);
+    }
+    Reader in{data, path, data.size() - 8, sizeof(SESSION_MAGIC)};
+    uint64_t version = in.getInt(2);
+    if (version != VERSION) {
+        throw std::runtime_error("Unsupported save version " + std::to_string(version) + ": " + path);
+    }
+    Reader checksum{data, path, data.size(), data.size() - 8};
+    if (checksum.getInt(8) != LevelLoader::sourceHash(std::string_view(data).substr(0, data.size() - 8))) {
+        throw std::runtime_error("Corrupt save file: " + path);
+    }
+
+    SavedSession session;
+    uint64_t level_length = in.getVarint();
+    in.need(level_length);
+    session.level = data.substr(in.pos, level_length);
+    in.pos += level_length;
+    session.level_id = in.getSigned();
+    session.start_hash = in.getInt(8);
+    uint32_t yaw_bits = static_cast<uint32_t>(in.getInt(4));
+    std::memcpy(&session.camera_yaw, &yaw_bits, sizeof(yaw_bits));
+
+    // every Pos takes at least three bytes, which bounds the counts before reserving
+    GameState& state = session.game.state;
+    state.player = in.getPos();
+    for (size_t i = 0, count = in.getCount(4); i < count; ++i) {
+        int bid = in.getSigned();
+        state.boxes[bid] = in.getPos();
+    }
+    for (size_t i = 0, count = in.getCount(4); i < count; ++i) {
+        int rid = in.getSigned();
+        state.boxrooms[rid] = in.getPos();
+    }
+    state.portal_just_passed = in.getOptionalPos();
+    state.hash = in.getInt(8);
+
+    size_t event_count = in.getCount(9);
+    session.game.journal.reserve(event_count);
+    for (size_t i = 0; i < event_count; ++i) {
+        MoveEvent event;
+        uint64_t type = in.getInt(1);
+        if (type != PLAYER && type != BOX && type != BOXROOM) {
+            throw std::runtime_error("Invalid event " + std::to_string(i) + " in save file: " + path);
+        }
+        event.object = {static_cast<CellType>(type), in.getSigned()};
+        event.from = in.getPos();
+        event.to = in.getPos();
+        event.portal = in.getOptionalPos();
+        session.game.journal.push_back(event);
+    }
+    size_t entry_count = in.getCount(3);
+    session.game.entries.reserve(entry_count);
+    size_t first = 0;
+    for (size_t i = 0; i < entry_count; ++i) {
+        JournalEntry entry;
+        entry.first = first;
+        entry.count = static_cast<size_t>(in.getVarint());
+        entry.portal = in.getOptionalPos();
+        entry.frozen = in.getSigned();
+        if (entry.count > event_count - first) {
+            throw std::runtime_error("Invalid journal in save file: " + path);
+        }
+        first += entry.count;
+        session.game.entries.push_back(entry);
+    }
+    session.game.position = static_cast<size_t>(in.getVarint());
+    if (first != event_count || session.game.position > entry_count || in.pos != in.end) {
+        throw std::runtime_error("Invalid journal in save file: " + path);
+    }
+    return session;
+}
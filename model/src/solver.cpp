@@ -0,0 +1,806 @@
+#include "../include/solver.hpp"
+#include "../include/compact_state.hpp"
+#include "../include/transposition_table.hpp"
+#include "../include/work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+size_t peakMemoryBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::stoull(line.substr(6)) * 1024;
+        }
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return static_cast<size_t>(usage.ru_maxrss);
+    }
+    return 0;
+#endif
+}
+
+std::string movesToString(const std::vector<Input>& moves)
+{
+    std::string text;
+    text.reserve(moves.size());
+    for (Input move: moves) {
+        switch (move) {
+            case UP: text += 'U'; break;
+            case DOWN: text += 'D'; break;
+            case LEFT: text += 'L'; break;
+            case RIGHT: text += 'R'; break;
+        }
+    }
+    return text;
+}
+
+namespace {
+
+const int DX[4] = {0, 0, -1, 1};    // indexed by Input
+const int DY[4] = {-1, 1, 0, 0};
+const int INF = INT_MAX / 2;
+
+/// Level geometry shared by the heuristic and the backward search
+struct LevelGeometry
+{
+    const std::vector<Room>& rooms;
+    std::vector<int> offsets;       // first global cell index of each room
+    std::vector<bool> placed;       // whether the room is a box room placed in the level
+    int cells = 0;
+
+    LevelGeometry(const std::vector<Room>& rooms, const GameState& initial) : rooms(rooms)
+    {
+        for (const auto& room: rooms) {
+            offsets.push_back(cells);
+            cells += room.size * room.size;
+        }
+        placed.assign(rooms.size(), false);
+        for (const auto& [rid, boxroom]: initial.boxrooms) {
+            placed[rid] = true;
+        }
+    }
+
+    int cellOf(Pos pos) const { return offsets[pos.room] + pos.y * rooms[pos.room].size + pos.x; }
+
+    bool isInside(Pos pos) const
+    {
+        return pos.room >= 0 && pos.room < rooms.size()
+            && pos.x >= 0 && pos.x < rooms[pos.room].size
+            && pos.y >= 0 && pos.y < rooms[pos.room].size;
+    }
+
+    bool isPassable(Pos pos) const
+    {
+        if (!isInside(pos)) {
+            return false;
+        }
+        CellKind cell = rooms[pos.room].cellAt(pos.x, pos.y);
+        return cell != CELL_WALL && cell != CELL_PORTAL_WALL;
+    }
+
+    /// Whether leaving pos in direction move exits its room through an entry
+    bool isExit(Pos pos, int move) const
+    {
+        return placed[pos.room] && rooms[pos.room].entryOn(static_cast<RoomSide>(move), pos.x, pos.y) >= 0;
+    }
+
+    /// Whether an object moving in direction move enters a box room at this entry
+    static bool entersAt(const Room& room, const std::array<int, 2>& entry, int move)
+    {
+        return (move == UP && entry[0] == room.size - 1)
+            || (move == DOWN && entry[0] == 0)
+            || (move == LEFT && entry[1] == room.size - 1)
+            || (move == RIGHT && entry[1] == 0);
+    }
+};
+
+/// Lower bounds on the number of moves needed to reach each target, from a relaxation of the
+/// rules in which boxes never block and box rooms may stand anywhere. Every object advances at
+/// most one relaxed edge per move, so the bound is admissible and consistent.
+class RelaxedDistances
+{
+public:
+    RelaxedDistances(const LevelGeometry& geometry, Pos player_target, const std::vector<Pos>& box_targets)
+        : geometry(geometry)
+    {
+        buildReverseGraph();
+        playerDistances = distancesTo(geometry.cellOf(player_target));
+        for (const auto& target: box_targets) {
+            targetDistances.push_back(distancesTo(geometry.cellOf(target)));
+        }
+    }
+
+    /// Lower bound on the moves left from a state, INF if the state cannot be won
+    int estimate(const GameState& state) const
+    {
+        int bound = playerDistances[geometry.cellOf(state.player)];
+        if (state.targets_remaining == 0) {
+            return bound;
+        }
+        for (const auto& distances: targetDistances) {
+            int nearest = INF;
+            for (const auto& [bid, box]: state.boxes) {
+                nearest = std::min(nearest, distances[geometry.cellOf(box)]);
+            }
+            for (const auto& [rid, boxroom]: state.boxrooms) {
+                nearest = std::min(nearest, distances[geometry.cellOf(boxroom)]);
+            }
+            bound = std::max(bound, nearest);
+        }
+        return bound;
+    }
+
+private:
+    const LevelGeometry& geometry;
+    std::vector<std::vector<std::pair<int, int>>> reverseEdges;   // node -> (predecessor, weight)
+    std::vector<int> playerDistances;
+    std::vector<std::vector<int>> targetDistances;
+
+    // Nodes are the cells, then ANYWHERE (where an exit may lead), then ENTER + move
+    // (from where the matching entries of any box room are reached)
+    int anywhere() const { return geometry.cells; }
+    int enter(int move) const { return geometry.cells + 1 + move; }
+
+    void buildReverseGraph()
+    {
+        const auto& rooms = geometry.rooms;
+        reverseEdges.assign(geometry.cells + 5, {});
+        for (int r = 0; r < rooms.size(); ++r) {
+            for (int y = 0; y < rooms[r].size; ++y) {
+                for (int x = 0; x < rooms[r].size; ++x) {
+                    Pos pos = {r, x, y};
+                    if (!geometry.isPassable(pos)) {
+                        continue;
+                    }
+                    int cell = geometry.cellOf(pos);
+                    reverseEdges[cell].push_back({anywhere(), 0});
+                    for (int move = 0; move < 4; ++move) {
+                        Pos next = {r, x + DX[move], y + DY[move]};
+                        bool exit = geometry.isExit(pos, move);
+                        if (geometry.isPassable(next)) {
+                            reverseEdges[geometry.cellOf(next)].push_back({cell, 1});
+                        }
+                        if (geometry.isPassable(next) || exit) {
+                            reverseEdges[enter(move)].push_back({cell, 1});
+                        }
+                        if (exit) {
+                            reverseEdges[anywhere()].push_back({cell, 1});
+                        }
+                    }
+                }
+            }
+            if (!geometry.placed[r]) {
+                continue;
+            }
+            for (const auto& entry: rooms[r].entries) {
+                for (int move = 0; move < 4; ++move) {
+                    if (LevelGeometry::entersAt(rooms[r], entry, move)) {
+                        reverseEdges[geometry.cellOf({r, entry[1], entry[0]})].push_back({enter(move), 0});
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<int> distancesTo(int target) const
+    {
+        std::vector<int> distances(reverseEdges.size(), INF);
+        std::deque<int> queue;
+        distances[target] = 0;
+        queue.push_back(target);
+        while (!queue.empty()) {
+            int node = queue.front();
+            queue.pop_front();
+            for (const auto& [prev, weight]: reverseEdges[node]) {
+                if (distances[node] + weight < distances[prev]) {
+                    distances[prev] = distances[node] + weight;
+                    if (weight == 0) {
+                        queue.push_front(prev);
+                    }
+                    else {
+                        queue.push_back(prev);
+                    }
+                }
+            }
+        }
+        distances.resize(geometry.cells);
+        return distances;
+    }
+};
+
+template <typename State>
+class Search
+{
+public:
+    Search(const Level& level, const SolverOptions& options)
+        : options(options), codec(level.rooms), probe(level), initial(startState(probe, options)),
+          geometry(level.rooms, initial),
+          heuristic(geometry, probe.getPlayerDestination(), probe.getBoxDestinations()),
+          pool(options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (int w = 0; w < pool.size(); ++w) {
+            plays.emplace_back(level);
+        }
+        children.resize(pool.size());
+        expandedCounts.assign(pool.size(), 0);
+        occupancyScratch.assign(pool.size(), std::vector<Occupant>(geometry.cells, {SPACE, -1}));
+
+        size_t table_bytes = options.bidirectional ? options.table_bytes / 2 : options.table_bytes;
+        forward.visited = std::make_unique<TranspositionTable>(level.rooms, initial, table_bytes);
+        if (options.bidirectional) {
+            backward.visited = std::make_unique<TranspositionTable>(level.rooms, initial, table_bytes);
+        }
+    }
+
+    SolveResult run()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        SolveResult result;
+        if (options.bidirectional && seedGoals()) {
+            result.bidirectional = true;
+            runBidirectional(result);
+        }
+        else {
+            runForward(result);
+        }
+
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // nodes also hold the states A* reopened at a smaller depth; the tables count each state once
+        result.states = forward.visited->size() + (backward.visited ? backward.visited->size() : 0);
+        for (size_t count: expandedCounts) {
+            result.expanded += count;
+        }
+        result.states_per_second = result.seconds > 0 ? result.states / result.seconds : 0;
+        result.optimal = result.solved && !(result.bidirectional && backwardIncomplete);
+        result.table_full = tableFull;
+        result.cancelled = !result.solved && !result.exhausted && cancelRequested();
+        result.peak_memory_bytes = peakMemoryBytes();
+        return result;
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node
+    {
+        State state;
+        uint32_t parent;    // NONE for the root / goal states
+        uint8_t move;       // move leading from parent (forward) or to parent (backward)
+        int g;              // depth in its search tree
+    };
+
+    struct Child
+    {
+        State state;
+        uint32_t parent;
+        uint8_t move;
+        int h;
+        bool win;
+        bool meets;         // also reached by the search in the other direction
+    };
+
+    struct Tree
+    {
+        std::vector<Node> nodes;
+        std::unique_ptr<TranspositionTable> visited;
+    };
+
+    const SolverOptions& options;
+    StateCodec<State> codec;
+    GamePlay probe;
+    GameState initial;
+    LevelGeometry geometry;
+    RelaxedDistances heuristic;
+    WorkStealingPool pool;
+    std::vector<GamePlay> plays;                           // one per worker
+    std::vector<std::vector<Child>> children;              // one per worker
+    std::vector<size_t> expandedCounts;                    // one per worker
+    std::vector<std::vector<Occupant>> occupancyScratch;   // one per worker, by global cell
+    Tree forward;
+    Tree backward;
+    std::atomic<bool> tableFull{false};
+    std::atomic<bool> backwardIncomplete{false};          // a pull may have missed predecessors
+
+    static GameState startState(GamePlay& probe, const SolverOptions& options)
+    {
+        if (options.start != nullptr) {
+            probe.setState(*options.start);
+        }
+        return probe.getCurrState();
+    }
+
+    bool cancelRequested() const
+    {
+        return options.cancel != nullptr && options.cancel->load(std::memory_order_relaxed);
+    }
+
+    bool overBudget() const
+    {
+        return tableFull || cancelRequested()
+            || (options.max_states != 0 && forward.nodes.size() + backward.nodes.size() >= options.max_states);
+    }
+
+    /// Record a state reached at depth g; false if it was seen before at the same or a smaller
+    /// depth, or there is no room left
+    bool visit(Tree& tree, const GameState& state, int g = 0)
+    {
+        TranspositionTable::Result result = tree.visited->insert(state, static_cast<uint32_t>(g));
+        if (result == TranspositionTable::FULL) {
+            tableFull = true;
+        }
+        return result == TranspositionTable::INSERTED || result == TranspositionTable::IMPROVED;
+    }
+
+    void expandForward(int worker, uint32_t index, Tree* other)
+    {
+        if (cancelRequested()) {
+            return;
+        }
+        GamePlay& play = plays[worker];
+        const Node& node = forward.nodes[index];
+        play.setState(codec.unpack(node.state));
+        if (forward.visited->depth(play.getCurrState()) < static_cast<uint32_t>(node.g)) {
+            return;    // reached again by a shorter path, which is expanded instead
+        }
+        for (int move = 0; move < 4; ++move) {
+            play.operate(static_cast<Input>(move));
+            const GameState& next = play.getNextState();
+            State child = codec.pack(next);
+            if (child == node.state || next.is_deadlocked) {
+                continue;
+            }
+            int h = heuristic.estimate(next);
+            if (h >= INF || !visit(forward, next, node.g + 1)) {
+                continue;
+            }
+            bool meets = other != nullptr && other->visited->contains(next);
+            children[worker].push_back({std::move(child), index, static_cast<uint8_t>(move), h, next.is_win, meets});
+        }
+        expandedCounts[worker]++;
+    }
+
+    void runForward(SolveResult& result)
+    {
+        forward.nodes.push_back({codec.pack(initial), NONE, 0, 0});
+        visit(forward, initial);
+        if (probe.getCurrState().is_win) {
+            result.solved = true;
+            return;
+        }
+
+        bool astar = options.algorithm == SOLVER_ASTAR;
+        int root_f = astar ? heuristic.estimate(initial) : 0;
+        if (root_f >= INF || initial.is_deadlocked) {
+            result.exhausted = true;
+            return;
+        }
+
+        std::vector<std::vector<uint32_t>> buckets(root_f + 1);
+        buckets[root_f].push_back(0);
+        int best_goal = INF;
+        uint32_t goal = NONE;
+
+        // All states of one f bucket are expanded in parallel rounds. A state may first be reached
+        // by a longer path (states of one bucket differ in g, and threads race to insert), so the
+        // table keeps each state's smallest g: a shorter path reopens the state, and the node of
+        // the longer one is skipped when its turn comes.
+        for (int f = root_f; f < buckets.size(); ++f) {
+            while (!buckets[f].empty()) {
+                std::vector<uint32_t> round;
+                round.swap(buckets[f]);
+                forward.visited->reserve(forward.visited->size() + 4 * round.size());
+                pool.run(round.size(), [&](int worker, size_t i) { expandForward(worker, round[i], nullptr); });
+                if (cancelRequested()) {
+                    return;    // the round may be incomplete
+                }
+
+                for (auto& local: children) {
+                    for (auto& child: local) {
+                        uint32_t index = static_cast<uint32_t>(forward.nodes.size());
+                        int g = forward.nodes[child.parent].g + 1;
+                        forward.nodes.push_back({std::move(child.state), child.parent, child.move, g});
+                        if (child.win) {
+                            if (g < best_goal) {
+                                best_goal = g;
+                                goal = index;
+                            }
+                            continue;
+                        }
+                        int child_f = std::max(f, astar ? g + child.h : g);
+                        if (child_f >= buckets.size()) {
+                            buckets.resize(child_f + 1);
+                        }
+                        buckets[child_f].push_back(index);
+                    }
+                    local.clear();
+                }
+
+                if (best_goal <= f) {
+                    break;
+                }
+                if (overBudget()) {
+                    return;
+                }
+            }
+            // a goal reached from this bucket cannot be beaten by a later one
+            if (best_goal <= f + 1) {
+                result.solved = true;
+                result.moves = pathTo(forward, goal);
+                return;
+            }
+        }
+        result.exhausted = true;
+    }
+
+    // --- Backward search -------------------------------------------------------------------
+
+    /// Fill the backward tree with every goal state; false if there are too many of them
+    bool seedGoals()
+    {
+        Pos player_target = probe.getPlayerDestination();
+        if (!geometry.isPassable(player_target)) {
+            return false;
+        }
+        const std::vector<Pos>& targets = probe.getBoxDestinations();
+        std::vector<int> boxroom_ids;
+        for (const auto& [rid, boxroom]: initial.boxrooms) {
+            boxroom_ids.push_back(rid);
+        }
+        int box_count = static_cast<int>(initial.boxes.size());
+
+        std::vector<Pos> cells;
+        for (int r = 0; r < geometry.rooms.size(); ++r) {
+            for (int y = 0; y < geometry.rooms[r].size; ++y) {
+                for (int x = 0; x < geometry.rooms[r].size; ++x) {
+                    Pos pos = {r, x, y};
+                    if (geometry.isPassable(pos) && !(pos == player_target)) {
+                        cells.push_back(pos);
+                    }
+                }
+            }
+        }
+
+        GameState goal;
+        goal.player = player_target;
+        goal.portal_just_passed = std::nullopt;
+        goal.is_win = true;
+        std::vector<bool> used(cells.size(), false);
+        bool too_many = false;
+
+        auto uncovered = [&]() {
+            int count = 0;
+            for (const auto& target: targets) {
+                bool covered = false;
+                for (size_t i = 0; i < cells.size() && !covered; ++i) {
+                    covered = used[i] && cells[i] == target;
+                }
+                count += covered ? 0 : 1;
+            }
+            return count;
+        };
+
+        // place box rooms (distinct) first, then boxes (interchangeable, in increasing cell order)
+        std::function<void(int, size_t)> place = [&](int object, size_t first_cell) {
+            if (too_many) {
+                return;
+            }
+            int remaining = static_cast<int>(boxroom_ids.size()) + box_count - object;
+            if (uncovered() > remaining) {
+                return;
+            }
+            if (remaining == 0) {
+                if (backward.nodes.size() >= options.max_goal_states) {
+                    too_many = true;
+                    return;
+                }
+                goal.hash = probe.hashState(goal);
+                backward.visited->reserve(backward.nodes.size() + 1);
+                if (visit(backward, goal)) {
+                    backward.nodes.push_back({codec.pack(goal), NONE, 0, 0});
+                }
+                too_many = tableFull;
+                return;
+            }
+            bool is_boxroom = object < boxroom_ids.size();
+            for (size_t i = is_boxroom ? 0 : first_cell; i < cells.size(); ++i) {
+                if (used[i]) {
+                    continue;
+                }
+                used[i] = true;
+                if (is_boxroom) {
+                    goal.boxrooms[boxroom_ids[object]] = cells[i];
+                    place(object + 1, 0);
+                }
+                else {
+                    goal.boxes[object - static_cast<int>(boxroom_ids.size())] = cells[i];
+                    place(object + 1, i + 1);
+                }
+                used[i] = false;
+            }
+        };
+
+        place(0, 0);
+        if (too_many || backward.nodes.empty()) {
+            backward.nodes.clear();
+            backward.visited.reset();
+            tableFull = false;
+            return false;
+        }
+        return true;
+    }
+
+    /// The position an object at pos reaches when moving in direction move, ignoring blockers
+    Pos stepFrom(Pos pos, int move, const GameState& state) const
+    {
+        if (geometry.isExit(pos, move)) {
+            auto boxroom = state.boxrooms.find(pos.room);
+            if (boxroom != state.boxrooms.end()) {
+                return {boxroom->second.room, boxroom->second.x + DX[move], boxroom->second.y + DY[move]};
+            }
+        }
+        return {pos.room, pos.x + DX[move], pos.y + DY[move]};
+    }
+
+    void expandBackward(int worker, uint32_t index, Tree* other)
+    {
+        if (cancelRequested()) {
+            return;
+        }
+        GamePlay& play = plays[worker];
+        std::vector<Occupant>& occupants = occupancyScratch[worker];
+        const Node& node = backward.nodes[index];
+        GameState state = codec.unpack(node.state);
+
+        occupants[geometry.cellOf(state.player)] = {PLAYER, -1};
+        for (const auto& [bid, box]: state.boxes) {
+            occupants[geometry.cellOf(box)] = {BOX, bid};
+        }
+        for (const auto& [rid, boxroom]: state.boxrooms) {
+            occupants[geometry.cellOf(boxroom)] = {BOXROOM, rid};
+        }
+        auto isFree = [&](Pos pos) {
+            return geometry.isPassable(pos) && occupants[geometry.cellOf(pos)].type == SPACE;
+        };
+
+        for (int move = 0; move < 4; ++move) {
+            Pos player = state.player;
+            bool incomplete = false;
+
+            // where the player may have come from
+            std::vector<Pos> origins;
+            Pos behind = {player.room, player.x - DX[move], player.y - DY[move]};
+            if (isFree(behind)) {
+                origins.push_back(behind);
+            }
+            auto container = state.boxrooms.find(player.room);
+            if (container != state.boxrooms.end()
+                && geometry.rooms[player.room].entryOn(static_cast<RoomSide>(move ^ 1), player.x, player.y) >= 0) {
+                incomplete = true;
+                // entered the box room, directly or right after leaving another one
+                Pos outside = {container->second.room, container->second.x - DX[move], container->second.y - DY[move]};
+                if (isFree(outside)) {
+                    origins.push_back(outside);
+                }
+                for (const auto& [rid, other_room]: state.boxrooms) {
+                    if (other_room == outside) {
+                        for (const auto& exit: geometry.rooms[rid].entries) {
+                            Pos from = {rid, exit[1], exit[0]};
+                            if (geometry.isExit(from, move) && isFree(from)) {
+                                origins.push_back(from);
+                            }
+                        }
+                    }
+                }
+            }
+            for (const auto& [rid, boxroom]: state.boxrooms) {
+                // left a box room standing just behind the player
+                if (boxroom.room == player.room && boxroom.x + DX[move] == player.x && boxroom.y + DY[move] == player.y) {
+                    incomplete = true;
+                    for (const auto& exit: geometry.rooms[rid].entries) {
+                        Pos from = {rid, exit[1], exit[0]};
+                        if (geometry.isExit(from, move) && isFree(from)) {
+                            origins.push_back(from);
+                        }
+                    }
+                }
+            }
+
+            // the objects in front of the player may have been pushed by it: pull back 0..k of them
+            std::vector<Pos> chain = {player};
+            for (Pos cell = stepFrom(player, move, state);
+                 geometry.isInside(cell) && occupants[geometry.cellOf(cell)].type != SPACE
+                    && chain.size() <= state.boxes.size() + state.boxrooms.size();
+                 cell = stepFrom(cell, move, state))
+            {
+                if (std::find(chain.begin(), chain.end(), cell) != chain.end()) {
+                    incomplete = true;
+                    break;
+                }
+                incomplete = incomplete || occupants[geometry.cellOf(cell)].type == BOXROOM
+                    || geometry.isExit(chain.back(), move);
+                chain.push_back(cell);
+            }
+
+            // Moves that took the player or a pushed object through a box room entry, or that pushed
+            // a box room, are only partly recovered: a solution through them may not be the shortest
+            if (incomplete) {
+                backwardIncomplete = true;
+            }
+
+            for (const auto& origin: origins) {
+                for (size_t pulled = 0; pulled < chain.size(); ++pulled) {
+                    GameState prev = state;
+                    prev.player = origin;
+                    for (size_t i = 1; i <= pulled; ++i) {
+                        const Occupant& object = occupants[geometry.cellOf(chain[i])];
+                        if (object.type == BOX) {
+                            prev.boxes[object.id] = chain[i - 1];
+                        }
+                        else {
+                            prev.boxrooms[object.id] = chain[i - 1];
+                        }
+                    }
+
+                    // keep the predecessor only if the game agrees
+                    play.setState(prev);
+                    play.operate(static_cast<Input>(move));
+                    if (codec.pack(play.getNextState()) != node.state) {
+                        continue;
+                    }
+                    const GameState& confirmed = play.getCurrState();
+                    if (!visit(backward, confirmed)) {
+                        continue;
+                    }
+                    bool meets = other != nullptr && other->visited->contains(confirmed);
+                    children[worker].push_back({codec.pack(confirmed), index, static_cast<uint8_t>(move), 0, false, meets});
+                }
+            }
+        }
+
+        occupants[geometry.cellOf(state.player)] = {SPACE, -1};
+        for (const auto& [bid, box]: state.boxes) {
+            occupants[geometry.cellOf(box)] = {SPACE, -1};
+        }
+        for (const auto& [rid, boxroom]: state.boxrooms) {
+            occupants[geometry.cellOf(boxroom)] = {SPACE, -1};
+        }
+        expandedCounts[worker]++;
+    }
+
+    void runBidirectional(SolveResult& result)
+    {
+        forward.nodes.push_back({codec.pack(initial), NONE, 0, 0});
+        visit(forward, initial);
+        if (backward.visited->contains(initial)) {
+            result.solved = true;
+            return;
+        }
+
+        std::vector<uint32_t> forward_frontier = {0};
+        std::vector<uint32_t> backward_frontier;
+        for (uint32_t i = 0; i < backward.nodes.size(); ++i) {
+            backward_frontier.push_back(i);
+        }
+
+        // expand the smaller frontier one layer at a time until the searches meet; the backward
+        // search may run dry early since it does not recover every predecessor
+        while (!forward_frontier.empty()) {
+            bool go_forward = backward_frontier.empty() || forward_frontier.size() <= backward_frontier.size();
+            Tree& tree = go_forward ? forward : backward;
+            Tree& other = go_forward ? backward : forward;
+            std::vector<uint32_t>& frontier = go_forward ? forward_frontier : backward_frontier;
+
+            std::vector<uint32_t> layer;
+            layer.swap(frontier);
+            // a backward expansion may pull several objects per direction
+            tree.visited->reserve(tree.visited->size() + (go_forward ? 4 : 16) * layer.size());
+            pool.run(layer.size(), [&](int worker, size_t i) {
+                if (go_forward) {
+                    expandForward(worker, layer[i], &backward);
+                }
+                else {
+                    expandBackward(worker, layer[i], &forward);
+                }
+            });
+            if (cancelRequested()) {
+                return;
+            }
+
+            std::vector<uint32_t> meetings;
+            for (auto& local: children) {
+                for (auto& child: local) {
+                    uint32_t index = static_cast<uint32_t>(tree.nodes.size());
+                    tree.nodes.push_back({std::move(child.state), child.parent, child.move, tree.nodes[child.parent].g + 1});
+                    frontier.push_back(index);
+                    if (child.meets) {
+                        meetings.push_back(index);
+                    }
+                }
+                local.clear();
+            }
+
+            if (!meetings.empty()) {
+                // find the meeting states in the other tree and keep the shortest joined path
+                std::unordered_map<State, uint32_t, StateHash<State>> wanted;
+                for (uint32_t index: meetings) {
+                    wanted.emplace(tree.nodes[index].state, index);
+                }
+                int best = INF;
+                uint32_t best_here = NONE, best_there = NONE;
+                for (uint32_t i = 0; i < other.nodes.size(); ++i) {
+                    auto found = wanted.find(other.nodes[i].state);
+                    if (found != wanted.end() && tree.nodes[found->second].g + other.nodes[i].g < best) {
+                        best = tree.nodes[found->second].g + other.nodes[i].g;
+                        best_here = found->second;
+                        best_there = i;
+                    }
+                }
+                uint32_t forward_node = go_forward ? best_here : best_there;
+                uint32_t backward_node = go_forward ? best_there : best_here;
+                result.solved = true;
+                result.moves = pathTo(forward, forward_node);
+                for (uint32_t i = backward_node; backward.nodes[i].parent != NONE; i = backward.nodes[i].parent) {
+                    result.moves.push_back(static_cast<Input>(backward.nodes[i].move));
+                }
+                return;
+            }
+            if (overBudget()) {
+                return;
+            }
+        }
+        result.exhausted = true;
+    }
+
+    std::vector<Input> pathTo(const Tree& tree, uint32_t index) const
+    {
+        std::vector<Input> moves;
+        for (uint32_t i = index; tree.nodes[i].parent != NONE; i = tree.nodes[i].parent) {
+            moves.push_back(static_cast<Input>(tree.nodes[i].move));
+        }
+        std::reverse(moves.begin(), moves.end());
+        return moves;
+    }
+};
+
+} // namespace
+
+SolveResult solve(const Level& level, const SolverOptions& options)
+{
+    return withCompactState(level.rooms, [&](auto tag) {
+        return Search<decltype(tag)>(level, options).run();
+    });
+}
@@ -0,0 +1,214 @@
+#include "../include/transposition_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomic words must not carry extra state");
+
+StatePacker::StatePacker(const std::vector<Room>& rooms, const GameState& layout)
+{
+    int cells = 0;
+    for (const auto& room: rooms) {
+        roomOffsets.push_back(cells);
+        roomSizes.push_back(room.size);
+        cells += room.size * room.size;
+    }
+    boxCount = static_cast<int>(layout.boxes.size());
+
+    // one extra value marks a box room that is not placed anywhere
+    bitsPerPos = 1;
+    while ((1ull << bitsPerPos) <= static_cast<uint64_t>(cells)) {
+        bitsPerPos++;
+    }
+    int positions = 1 + static_cast<int>(rooms.size()) + boxCount;
+    wordCount = (positions * bitsPerPos + 63) / 64;
+    if (wordCount > MAX_WORDS) {
+        throw std::runtime_error("Level has too many objects to pack a state into " + std::to_string(MAX_WORDS) + " words");
+    }
+}
+
+void StatePacker::pack(const GameState& state, uint64_t* words) const
+{
+    std::fill(words, words + wordCount, 0);
+    int bit = 0;
+    auto put = [&](uint64_t value) {
+        words[bit >> 6] |= value << (bit & 63);
+        if ((bit & 63) + bitsPerPos > 64) {
+            words[(bit >> 6) + 1] |= value >> (64 - (bit & 63));
+        }
+        bit += bitsPerPos;
+    };
+    auto cellOf = [&](const Pos& pos) {
+        return static_cast<uint64_t>(roomOffsets[pos.room] + pos.y * roomSizes[pos.room] + pos.x);
+    };
+
+    put(cellOf(state.player));
+
+    uint64_t absent = (1ull << bitsPerPos) - 1;
+    for (int rid = 0; rid < roomOffsets.size(); ++rid) {
+        auto boxroom = state.boxrooms.find(rid);
+        put(boxroom == state.boxrooms.end() ? absent : cellOf(boxroom->second));
+    }
+
+    std::array<uint64_t, MAX_WORDS * 64> boxes;
+    int n = 0;
+    for (const auto& [bid, box]: state.boxes) {
+        boxes[n++] = cellOf(box);
+    }
+    std::sort(boxes.begin(), boxes.begin() + n);
+    for (int i = 0; i < n; ++i) {
+        put(boxes[i]);
+    }
+}
+
+void TranspositionTable::FreeDeleter::operator() (std::atomic<uint64_t>* slots) const
+{
+    std::free(slots);
+}
+
+TranspositionTable::TranspositionTable(const std::vector<Room>& rooms, const GameState& layout, size_t memory_bytes)
+    : packer(rooms, layout)
+{
+    slotWords = 2 + packer.words();
+    // growing to maxSlots keeps the previous array of maxSlots / 2 alive while rehashing, so the
+    // budget has to hold both
+    maxSlots = 64;
+    while ((maxSlots * 2 + maxSlots) * slotWords * sizeof(uint64_t) <= memory_bytes) {
+        maxSlots *= 2;
+    }
+    allocate(std::min<size_t>(maxSlots, 4096));
+}
+
+void TranspositionTable::allocate(size_t slot_count)
+{
+    std::unique_ptr<std::atomic<uint64_t>[], FreeDeleter> old_slots = std::move(slots);
+    size_t old_count = old_slots ? mask + 1 : 0;
+
+    slots.reset(static_cast<std::atomic<uint64_t>*>(std::calloc(slot_count * slotWords, sizeof(uint64_t))));
+    if (!slots) {
+        throw std::bad_alloc();
+    }
+    mask = slot_count - 1;
+    limit = slot_count - slot_count / 8;
+
+    // move the stored states over; their keys give the new slots directly
+    for (size_t i = 0; i < old_count; ++i) {
+        const std::atomic<uint64_t>* old_slot = old_slots.get() + i * slotWords;
+        uint64_t key = old_slot[0].load(std::memory_order_relaxed);
+        if (key == EMPTY) {
+            continue;
+        }
+        size_t j = key & mask;
+        while (slot(j)[0].load(std::memory_order_relaxed) != EMPTY) {
+            j = (j + 1) & mask;
+        }
+        for (size_t w = 0; w < slotWords; ++w) {
+            slot(j)[w].store(old_slot[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+}
+
+bool TranspositionTable::reserve(size_t states)
+{
+    size_t slot_count = mask + 1;
+    while (states > slot_count - slot_count / 8 && slot_count < maxSlots) {
+        slot_count *= 2;
+    }
+    if (slot_count != mask + 1) {
+        allocate(slot_count);
+    }
+    return states <= limit;
+}
+
+bool TranspositionTable::matches(size_t index, const uint64_t* packed) const
+{
+    const std::atomic<uint64_t>* data = slot(index) + 2;
+    for (int w = 0; w < packer.words(); ++w) {
+        if (data[w].load(std::memory_order_relaxed) != packed[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TranspositionTable::Result TranspositionTable::insert(const GameState& state, uint32_t depth)
+{
+    uint64_t packed[StatePacker::MAX_WORDS];
+    packer.pack(state, packed);
+    uint64_t key = keyOf(state.hash);
+
+    for (size_t i = key & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        std::atomic<uint64_t>& slot_key = slot(i)[0];
+        uint64_t current = slot_key.load(std::memory_order_acquire);
+
+        if (current == EMPTY) {
+            if (count.load(std::memory_order_relaxed) >= limit) {
+                return FULL;
+            }
+            if (slot_key.compare_exchange_strong(current, BUSY, std::memory_order_acquire)) {
+                slot(i)[1].store(depth, std::memory_order_relaxed);
+                std::atomic<uint64_t>* data = slot(i) + 2;
+                for (int w = 0; w < packer.words(); ++w) {
+                    data[w].store(packed[w], std::memory_order_relaxed);
+                }
+                slot_key.store(key, std::memory_order_release);
+                count.fetch_add(1, std::memory_order_relaxed);
+                return INSERTED;
+            }
+            // another thread claimed the slot first; 'current' now holds its key
+        }
+        while (current == BUSY) {
+            std::this_thread::yield();
+            current = slot_key.load(std::memory_order_acquire);
+        }
+        if (current == key && matches(i, packed)) {
+            std::atomic<uint64_t>& stored = slot(i)[1];
+            uint64_t known = stored.load(std::memory_order_relaxed);
+            while (depth < known) {
+                if (stored.compare_exchange_weak(known, depth, std::memory_order_relaxed)) {
+                    return IMPROVED;
+                }
+            }
+            return PRESENT;
+        }
+    }
+    return FULL;
+}
+
+bool TranspositionTable::contains(const GameState& state) const
+{
+    uint64_t packed[StatePacker::MAX_WORDS];
+    packer.pack(state, packed);
+    return find(packed, keyOf(state.hash)) != nullptr;
+}
+
+uint32_t TranspositionTable::depth(const GameState& state) const
+{
+    uint64_t packed[StatePacker::MAX_WORDS];
+    packer.pack(state, packed);
+    const std::atomic<uint64_t>* found = find(packed, keyOf(state.hash));
+    return found ? static_cast<uint32_t>(found[1].load(std::memory_order_relaxed)) : NO_DEPTH;
+}
+
+const std::atomic<uint64_t>* TranspositionTable::find(const uint64_t* packed, uint64_t key) const
+{
+    for (size_t i = key & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        const std::atomic<uint64_t>& slot_key = slot(i)[0];
+        uint64_t current = slot_key.load(std::memory_order_acquire);
+        while (current == BUSY) {
+            std::this_thread::yield();
+            current = slot_key.load(std::memory_order_acquire);
+        }
+        if (current == EMPTY) {
+            return nullptr;
+        }
+        if (current == key && matches(i, packed)) {
+            return slot(i);
+        }
+    }
+    return nullptr;
+}
@@ -5,9 +5,7 @@
 
 Interface::Interface(const Level level)
 {
-    for (const auto& room: level.rooms){
-        scenes.push_back(room.scene);
-    }
+    rooms = level.rooms;
 }
 
 void Interface::renderBegin()
@@ -46,50 +44,42 @@ void Interface::render(GameState curr_state, GameState next_state)
                   << " to room " << next_state.player.room << std::endl;
     }
     
+    std::cout << "Targets remaining: " << next_state.targets_remaining << std::endl;
+
+    if (next_state.is_deadlocked) {
+        std::cout << "You're stuck: this level can no longer be won." << std::endl;
+    }
+
     if (next_state.is_win) {
         std::cout << "*** CONGRATULATIONS! YOU WON! ***" << std::endl;
     }
     
     std::cout << std::endl;
     
-    // Create a copy of the current room scene for rendering
-    Scene display_scene = scenes[next_state.player.room];
-    
-    // Place boxes on the display scene
-    for (const auto& [bid, box] : next_state.boxes) {
-        if (box.room == next_state.player.room) {
-            // Check if this position has a room identifier
-            std::string original_cell = scenes[box.room][box.y][box.x];
-            display_scene[box.y][box.x] = "B"; // Regular box
-        }
-    }
-    for (const auto& [rid, boxroom] : next_state.boxrooms) {
-        if (boxroom.room == next_state.player.room) {
-            std::string original_cell = scenes[boxroom.room][boxroom.y][boxroom.x];
-            display_scene[boxroom.y][boxroom.x] = std::to_string(rid);
-        }
-    }
+    // Build a glyph grid of the current room for rendering
+    const int size = rooms[next_state.player.room].size;
+    std::vector<char> display_scene = roomGlyphs(next_state.player.room, next_state);
     
     // Place player on the display scene
-    display_scene[next_state.player.y][next_state.player.x] = "P";
+    display_scene[next_state.player.y * size + next_state.player.x] = 'P';
     
     // Render the scene
-    for (int y = 0; y < MAX_SIZE; ++y) {
-        for (int x = 0; x < MAX_SIZE; ++x) {
-            std::string cell = display_scene[y][x];
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            char cell = display_scene[y * size + x];
             
             // Color coding for better visibility (if terminal supports it)
-            if (cell == "P") {
+            if (cell == 'P') {
                 std::cout << "\033[32mP\033[0m "; // Green player
-            } else if (cell == "B") {
+            } else if (cell == 'B') {
                 std::cout << "\033[33mB\033[0m "; // Yellow box
-            } else if (cell >= "1" && cell <= "9") {
+            } else if (cell >= '0' && cell <= '9') {
                 std::cout << "\033[35m" << cell << "\033[0m "; // Magenta portal box
-            } else if (cell == "=") {
+            } else if (cell == '=') {
                 std::cout << "\033[31m=\033[0m "; // Red player destination
-            } else if (cell == "_") {
+            } else if (cell == '_') {
                 std::cout << "\033[34m_\033[0m "; // Blue box destination
-            } else if (cell == "#") {
+            } else if (cell == '#') {
                 std::cout << "# ";
             } else {
                 std::cout << ". ";
@@ -101,39 +91,26 @@ void Interface::render(GameState curr_state, GameState next_state)
     std::cout << std::endl;
     
     // Show other rooms for reference
-    for (int room = 0; room < scenes.size(); ++room) {
+    for (int room = 0; room < rooms.size(); ++room) {
         if (room != next_state.player.room) {
             std::cout << "Room " << room << ":" << std::endl;
-            Scene room_display = scenes[room];
-            
-            // Place boxes in this room
-            for (const auto& [bid, box] : next_state.boxes) {
-                if (box.room == room) {
-                    std::string original_cell = scenes[box.room][box.y][box.x];
-                    room_display[box.y][box.x] = "B";
-                }
-            }
-            for (const auto& [rid, boxroom] : next_state.boxrooms) {
-                if (boxroom.room == room) {
-                    std::string original_cell = scenes[boxroom.room][boxroom.y][boxroom.x];
-                    room_display[boxroom.y][boxroom.x] = std::to_string(rid);
-                }
-            }
+            const int room_size = rooms[room].size;
+            std::vector<char> room_display = roomGlyphs(room, next_state);
             
             // Show a smaller version
             bool has_content = false;
-            for (int y = 0; y < MAX_SIZE; ++y) {
+            for (int y = 0; y < room_size; ++y) {
                 bool line_has_content = false;
-                for (int x = 0; x < MAX_SIZE; ++x) {
-                    if (room_display[y][x] != "#") {
+                for (int x = 0; x < room_size; ++x) {
+                    if (room_display[y * room_size + x] != '#') {
                         line_has_content = true;
                         has_content = true;
                         break;
                     }
                 }
                 if (line_has_content) {
-                    for (int x = 0; x < MAX_SIZE; ++x) {
-                        std::cout << room_display[y][x] << " ";
+                    for (int x = 0; x < room_size; ++x) {
+                        std::cout << room_display[y * room_size + x] << " ";
                     }
                     std::cout << std::endl;
                 }
@@ -148,6 +125,34 @@ void Interface::render(GameState curr_state, GameState next_state)
     std::cout << "Enter move (w/a/s/d) or q to quit: ";
 }
 
+std::vector<char> Interface::roomGlyphs(int room, const GameState& state) const
+{
+    const int size = rooms[room].size;
+    std::vector<char> glyphs(rooms[room].scene.size());
+    for (int i = 0; i < glyphs.size(); ++i) {
+        switch (rooms[room].scene[i]) {
+            case CELL_WALL: glyphs[i] = '#'; break;
+            case CELL_PORTAL_WALL: glyphs[i] = '|'; break;
+            case CELL_PLAYER_TARGET: glyphs[i] = '='; break;
+            case CELL_BOX_TARGET: glyphs[i] = '_'; break;
+            default: glyphs[i] = '.'; break;
+        }
+    }
+
+    // Place boxes and box rooms
+    for (const auto& [bid, box] : state.boxes) {
+        if (box.room == room) {
+            glyphs[box.y * size + box.x] = 'B';
+        }
+    }
+    for (const auto& [rid, boxroom] : state.boxrooms) {
+        if (boxroom.room == room) {
+            glyphs[boxroom.y * size + boxroom.x] = static_cast<char>('0' + rid);
+        }
+    }
+    return glyphs;
+}
+
 Input Interface::processInput(char c)
 {
     switch (c) {
@@ -14,7 +14,9 @@ public:
     void render(GameState curr_state, GameState next_state); //param curr_state is for motion rendering in gui. just print next_state in cli.
     Input processInput(char c);
 private:
-    std::vector<Scene> scenes;
+    std::vector<char> roomGlyphs(int room, const GameState& state) const;
+
+    std::vector<Room> rooms;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "gameplay.hpp"
+#include "level_loader.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// @brief Whether a game's state agrees with a fresh game set to the same positions
+bool sameAsFresh(const Level& level, const GameState& state, std::string& why)
+{
+    GamePlay fresh(level);
+    fresh.setState(state);
+    const GameState& expected = fresh.getCurrState();
+    if (state.hash != expected.hash || state.targets_remaining != expected.targets_remaining
+        || state.is_win != expected.is_win) {
+        why = "positions or targets differ";
+        return false;
+    }
+    if (state.stuck_objects != expected.stuck_objects || state.is_deadlocked != expected.is_deadlocked) {
+        why = "stuck_objects " + std::to_string(state.stuck_objects) + " deadlocked " + std::to_string(state.is_deadlocked)
+              + ", expected " + std::to_string(expected.stuck_objects) + " " + std::to_string(expected.is_deadlocked);
+        return false;
+    }
+    return true;
+}
+
+/// @brief Random play on a level; after every move the game must agree with a fresh game, and
+///        the session is restored into a new game, which must report the same counts and then
+///        undo and redo through states equal to those of fresh games
+/// @return Number of failures
+int checkLevel(const std::string& path, int walks, int moves, int& stuck_restores)
+{
+    Level level = LevelLoader::loadLevel(path);
+    std::mt19937 random(12345);
+    int failures = 0;
+
+    for (int walk = 0; walk < walks && failures == 0; ++walk) {
+        GamePlay game(level);
+        for (int step = 0; step < moves && failures == 0; ++step) {
+            if (random() % 5 == 0 && game.canUndo()) {
+                game.undo();
+            }
+            else {
+                game.operate(static_cast<Input>(random() % 4));
+                game.updateState();
+            }
+
+            std::string why;
+            const GameState& live = game.getCurrState();
+            if (!sameAsFresh(level, live, why)) {
+                std::cout << path << ": walk " << walk << " move " << step << ", live game: " << why << "\n";
+                failures++;
+                break;
+            }
+
+            GameSession session;
+            game.saveSession(session);
+            GamePlay restored(level);
+            restored.restoreSession(session);
+            stuck_restores += restored.getCurrState().stuck_objects > 0;
+            if (restored.getCurrState().stuck_objects != live.stuck_objects
+                || restored.getCurrState().is_deadlocked != live.is_deadlocked) {
+                std::cout << path << ": walk " << walk << " move " << step << ": restored counts differ from the live game\n";
+                failures++;
+                break;
+            }
+
+            int undone = 0;
+            while (failures == 0) {
+                if (!sameAsFresh(level, restored.getCurrState(), why)) {
+                    std::cout << path << ": walk " << walk << " move " << step << ", after " << undone
+                              << " undos: " << why << "\n";
+                    failures++;
+                }
+                if (!restored.undo()) {
+                    break;
+                }
+                undone++;
+            }
+            while (failures == 0 && restored.redo()) {
+                if (!sameAsFresh(level, restored.getCurrState(), why)) {
+                    std::cout << path << ": walk " << walk << " move " << step << ", redoing: " << why << "\n";
+                    failures++;
+                }
+            }
+            restored.rewind(static_cast<int>(session.entries.size() - session.position));
+            if (failures == 0 && restored.getCurrState().hash != game.getCurrState().hash) {
+                std::cout << path << ": walk " << walk << " move " << step << ": undo and redo do not return to the saved state\n";
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+/// @brief A level that must not be playable: loading it or starting a game on it has to throw
+/// @return Number of failures
+int checkRejected(const std::string& path)
+{
+    try {
+        GamePlay game(LevelLoader::loadLevel(path));
+    }
+    catch (const std::exception&) {
+        return 0;
+    }
+    std::cout << path << ": accepted, but it is not a valid level\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: session_test levels_dir... [--reject invalid_levels_dir...]\n";
+        return 2;
+    }
+    std::vector<std::string> paths;
+    std::vector<std::string> rejected;
+    bool reject = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--reject") {
+            reject = true;
+            continue;
+        }
+        for (const auto& entry: std::filesystem::directory_iterator(argv[i])) {
+            if (entry.path().extension() == ".json") {
+                (reject ? rejected : paths).push_back(entry.path().string());
+            }
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    std::sort(rejected.begin(), rejected.end());
+
+    int failures = 0;
+    int stuck_restores = 0;
+    for (const auto& path: rejected) {
+        failures += checkRejected(path);
+    }
+    try {
+        for (const auto& path: paths) {
+            failures += checkLevel(path, 20, 60, stuck_restores);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cout << e.what() << "\n";
+        return 1;
+    }
+
+    // the walks must reach states with stuck objects, or the case this guards against was never tried
+    if (stuck_restores == 0) {
+        std::cout << "no state with stuck objects was restored\n";
+        failures++;
+    }
+    std::cout << paths.size() << " levels, " << rejected.size() << " rejected, " << stuck_restores << " sessions with stuck objects restored, "
+              << failures << " failures\n";
+    return failures == 0 ? 0 : 1;
+}
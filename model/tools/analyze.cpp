@@ -0,0 +1,334 @@
+#include "level_loader.hpp"
+#include "gameplay.hpp"
+#include "compact_state.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "Usage: analyze [--max-states N] [--threads N] [--json] [--sort states|moves|dead-ends] level.json|dir...\n";
+}
+
+const uint32_t NONE = 0xFFFFFFFF;        // successors: the move is blocked
+const uint32_t FRONTIER = 0xFFFFFFFE;    // successors: the move leads past the state limit
+
+/// @brief Metrics of one level
+struct LevelReport
+{
+    std::string path;
+    std::string error;                ///< Why the level could not be analysed, empty if it was
+    int rooms = 0;
+    int boxes = 0;
+    size_t states = 0;                ///< Reachable states enumerated
+    bool complete = false;            ///< Whether that is every reachable state
+    size_t transitions = 0;           ///< Moves between distinct states
+    size_t portal_transitions = 0;    ///< Moves that take an object through a box room entry
+    size_t win_states = 0;
+    size_t dead_ends = 0;             ///< States from which no win state can be reached
+    int solution_moves = -1;          ///< Length of the shortest solution, -1 if none was reached
+    int portal_crossings = 0;         ///< Box room entries passed by any object along that solution
+    double seconds = 0;
+
+    double deadEndRatio() const { return states ? static_cast<double>(dead_ends) / states : 0; }
+};
+
+/// @brief Enumerate the states reachable from a level's initial state, breadth-first
+/// @details Successors come from GamePlay::operate(). Won states end the game and are not
+///          expanded. Once max_states are stored, moves to new states are recorded as leading
+///          to the frontier, which counts as possibly winnable; the dead-end count is then a
+///          lower bound.
+template <typename State>
+void explore(const Level& level, size_t max_states, LevelReport& report)
+{
+    GamePlay game(level);
+    StateCodec<State> codec(game.getRooms());
+    const GameState initial = game.getCurrState();
+    report.rooms = static_cast<int>(level.rooms.size());
+    report.boxes = static_cast<int>(initial.boxes.size());
+
+    std::unordered_map<State, uint32_t, StateHash<State>> index;
+    std::vector<State> states = {codec.pack(initial)};
+    std::vector<uint32_t> parents = {NONE};
+    std::vector<uint8_t> parent_moves = {0};
+    std::vector<uint32_t> successors;    // 4 per state, indexed by Input
+    std::vector<uint8_t> wins;
+    index.emplace(states[0], 0);
+    uint32_t goal = NONE;
+    bool full = false;
+
+    // stored states are expanded in the order they were found, which is breadth-first
+    for (uint32_t i = 0; i < states.size(); ++i) {
+        const State current = states[i];
+        game.setState(codec.unpack(current));
+        bool win = game.getCurrState().is_win;
+        wins.push_back(win);
+        if (win) {
+            report.win_states++;
+            if (goal == NONE) {
+                goal = i;
+            }
+            successors.insert(successors.end(), 4, NONE);
+            continue;
+        }
+
+        for (int move = UP; move <= RIGHT; ++move) {
+            game.operate(static_cast<Input>(move));
+            State child = codec.pack(game.getNextState());
+            if (child == current) {
+                successors.push_back(NONE);
+                continue;
+            }
+            report.transitions++;
+            for (const auto& event: game.getMoveEvents()) {
+                if (event.portal.has_value()) {
+                    report.portal_transitions++;
+                    break;
+                }
+            }
+
+            auto found = index.find(child);
+            if (found != index.end()) {
+                successors.push_back(found->second);
+            }
+            else if (states.size() >= max_states) {
+                full = true;
+                successors.push_back(FRONTIER);
+            }
+            else {
+                uint32_t id = static_cast<uint32_t>(states.size());
+                index.emplace(child, id);
+                states.push_back(std::move(child));
+                parents.push_back(i);
+                parent_moves.push_back(static_cast<uint8_t>(move));
+                successors.push_back(id);
+            }
+        }
+    }
+    report.states = states.size();
+    report.complete = !full;
+    index.clear();
+
+    // a state is alive if a win state (or the unexplored frontier) can be reached from it:
+    // propagate backwards over the reversed successor graph
+    std::vector<uint32_t> first(states.size() + 1, 0);
+    for (uint32_t next: successors) {
+        if (next < FRONTIER) {
+            first[next + 1]++;
+        }
+    }
+    for (size_t i = 0; i < states.size(); ++i) {
+        first[i + 1] += first[i];
+    }
+    std::vector<uint32_t> predecessors(first.back());
+    std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+    std::vector<uint8_t> alive(states.size(), 0);
+    std::vector<uint32_t> queue;
+    for (uint32_t i = 0; i < states.size(); ++i) {
+        for (int move = 0; move < 4; ++move) {
+            uint32_t next = successors[i * 4 + move];
+            if (next < FRONTIER) {
+                predecessors[fill[next]++] = i;
+            }
+            else if (next == FRONTIER && !alive[i]) {
+                alive[i] = 1;
+                queue.push_back(i);
+            }
+        }
+        if (wins[i] && !alive[i]) {
+            alive[i] = 1;
+            queue.push_back(i);
+        }
+    }
+    for (size_t q = 0; q < queue.size(); ++q) {
+        uint32_t state = queue[q];
+        for (uint32_t p = first[state]; p < first[state + 1]; ++p) {
+            if (!alive[predecessors[p]]) {
+                alive[predecessors[p]] = 1;
+                queue.push_back(predecessors[p]);
+            }
+        }
+    }
+    report.dead_ends = states.size() - queue.size();
+
+    if (goal == NONE) {
+        return;
+    }
+    std::vector<Input> solution;
+    for (uint32_t s = goal; parents[s] != NONE; s = parents[s]) {
+        solution.push_back(static_cast<Input>(parent_moves[s]));
+    }
+    std::reverse(solution.begin(), solution.end());
+    report.solution_moves = static_cast<int>(solution.size());
+
+    game.setState(initial);
+    for (Input move: solution) {
+        game.operate(move);
+        for (const auto& event: game.getMoveEvents()) {
+            report.portal_crossings += event.portal.has_value();
+        }
+        game.updateState();
+    }
+}
+
+LevelReport analyzeLevel(const std::string& path, size_t max_states)
+{
+    LevelReport report;
+    report.path = path;
+    auto started = std::chrono::steady_clock::now();
+    try {
+        Level level = LevelLoader::loadLevel(path);
+        withCompactState(level.rooms, [&](auto tag) { explore<decltype(tag)>(level, max_states, report); });
+    }
+    catch (const std::exception& e) {
+        report.error = e.what();
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+/// @brief The level files named on the command line, directories expanded to their *.json files
+std::vector<std::string> collectLevels(const std::vector<std::string>& args)
+{
+    std::vector<std::string> paths;
+    for (const auto& arg: args) {
+        if (!std::filesystem::is_directory(arg)) {
+            paths.push_back(arg);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto& entry: std::filesystem::directory_iterator(arg)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".json") {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+    }
+    return paths;
+}
+
+void printCsv(const std::vector<LevelReport>& reports)
+{
+    std::cout << "level,rooms,boxes,states,complete,transitions,portal_transitions,win_states,"
+                 "dead_ends,dead_end_ratio,solution_moves,portal_crossings,seconds,error\n";
+    for (const auto& r: reports) {
+        std::cout << '"' << r.path << "\"," << r.rooms << ',' << r.boxes << ',' << r.states << ',' << r.complete << ','
+                  << r.transitions << ',' << r.portal_transitions << ',' << r.win_states << ',' << r.dead_ends << ','
+                  << r.deadEndRatio() << ',' << r.solution_moves << ',' << r.portal_crossings << ',' << r.seconds << ",\""
+                  << r.error << "\"\n";
+    }
+}
+
+void printJson(const std::vector<LevelReport>& reports)
+{
+    nlohmann::ordered_json out = nlohmann::ordered_json::array();
+    for (const auto& r: reports) {
+        nlohmann::ordered_json level = {{"level", r.path}};
+        if (!r.error.empty()) {
+            level["error"] = r.error;
+            out.push_back(level);
+            continue;
+        }
+        level["rooms"] = r.rooms;
+        level["boxes"] = r.boxes;
+        level["states"] = r.states;
+        level["complete"] = r.complete;
+        level["transitions"] = r.transitions;
+        level["portal_transitions"] = r.portal_transitions;
+        level["win_states"] = r.win_states;
+        level["dead_ends"] = r.dead_ends;
+        level["dead_end_ratio"] = r.deadEndRatio();
+        level["solution_moves"] = r.solution_moves;
+        level["portal_crossings"] = r.portal_crossings;
+        level["seconds"] = r.seconds;
+        out.push_back(level);
+    }
+    std::cout << out.dump(2) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t max_states = 2000000;
+    int threads = 0;
+    bool as_json = false;
+    std::string sort_key;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-states" && i + 1 < argc) {
+            max_states = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--json") {
+            as_json = true;
+        }
+        else if (arg == "--sort" && i + 1 < argc && (std::string(argv[i + 1]) == "states"
+                 || std::string(argv[i + 1]) == "moves" || std::string(argv[i + 1]) == "dead-ends")) {
+            sort_key = argv[++i];
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            printUsage();
+            return 2;
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+    std::vector<std::string> paths = collectLevels(args);
+    if (paths.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    // one level per task: a level's search is sequential, levels run on all cores
+    std::vector<LevelReport> reports(paths.size());
+    WorkStealingPool pool(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    pool.run(paths.size(), [&](int, size_t i) { reports[i] = analyzeLevel(paths[i], max_states); });
+
+    // ascending, so the easiest levels come first; unsolved ones go last
+    auto key = [&](const LevelReport& r) {
+        if (sort_key == "states") {
+            return static_cast<double>(r.states);
+        }
+        if (sort_key == "dead-ends") {
+            return r.deadEndRatio();
+        }
+        return r.solution_moves < 0 ? 1e300 : static_cast<double>(r.solution_moves);
+    };
+    if (!sort_key.empty()) {
+        std::stable_sort(reports.begin(), reports.end(),
+                         [&](const LevelReport& a, const LevelReport& b) { return key(a) < key(b); });
+    }
+
+    if (as_json) {
+        printJson(reports);
+    }
+    else {
+        printCsv(reports);
+    }
+
+    // exit status is non-zero if any level could not be loaded
+    for (const auto& r: reports) {
+        if (!r.error.empty()) {
+            std::cerr << r.path << ": " << r.error << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
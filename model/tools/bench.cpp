@@ -0,0 +1,444 @@
+#include "level_loader.hpp"
+#include "gameplay.hpp"
+#include "batch_simulator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every allocation of the process goes through these, so a benchmark can count
+// the allocations made by the code it times.
+namespace {
+std::atomic<size_t> allocationCount{0};
+volatile uint64_t benchmarkSink;    ///< Keeps timed results from being optimized away
+}
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// GCC flags free() of memory it knows came from operator new, not seeing that new is replaced too
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void printUsage()
+{
+    std::cerr << "Usage: bench [--moves N] [--batch GAMES] [--json] [--no-synthetic] [level.json...]\n";
+}
+
+double nanosecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+/// @brief Distribution of a timed operation, in nanoseconds
+struct Summary
+{
+    size_t samples = 0;
+    double median = 0;
+    double p99 = 0;
+    double mean = 0;
+};
+
+Summary summarize(std::vector<double> ns)
+{
+    Summary summary;
+    summary.samples = ns.size();
+    if (ns.empty()) {
+        return summary;
+    }
+    std::sort(ns.begin(), ns.end());
+    summary.median = ns[ns.size() / 2];
+    summary.p99 = ns[std::min(ns.size() - 1, ns.size() * 99 / 100)];
+    double total = 0;
+    for (double v: ns) {
+        total += v;
+    }
+    summary.mean = total / ns.size();
+    return summary;
+}
+
+/// @brief Measurements of one level
+struct LevelReport
+{
+    std::string name;
+    int rooms = 0;
+    int cells = 0;
+    int objects = 0;
+    Summary load;                   ///< LevelLoader::loadLevel (levels read from files only)
+    Summary construct;              ///< GamePlay constructor
+    Summary operate;                ///< operate() of one random move
+    Summary update;                 ///< updateState() after it
+    Summary state_copy;             ///< Copy of the current GameState
+    double allocs_per_move = 0;     ///< Allocations of operate() + updateState(), averaged over the walk
+    double allocs_per_copy = 0;     ///< Allocations of one state copy
+    double moves_per_second = 0;    ///< Moves of the walk divided by the time spent in them
+    size_t batch_games = 0;         ///< Games stepped together by BatchSimulator (0 = not measured)
+    double batch_steps_per_second = 0;  ///< Game steps per second of BatchSimulator::step()
+};
+
+/// @brief Build a large single-level benchmark layout
+/// @details A walled square room with scattered walls, one box and one box target per 50 cells,
+///          and 'box_rooms' small box rooms open on every side, each holding a box.
+Level makeSyntheticLevel(int size, int box_rooms, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    Level level;
+    level.id = 1000 + size;
+    level.room_num = 1 + box_rooms;
+    level.rooms.resize(level.room_num);
+
+    Room& main = level.rooms[0];
+    main.size = size;
+    main.is_box = false;
+    main.scene.assign(static_cast<size_t>(size) * size, CELL_WALL);
+    std::vector<int> free_cells;
+    for (int y = 1; y < size - 1; ++y) {
+        for (int x = 1; x < size - 1; ++x) {
+            if (rng() % 100 < 6) {
+                continue;
+            }
+            main.scene[y * size + x] = CELL_FLOOR;
+            free_cells.push_back(y * size + x);
+        }
+    }
+    std::shuffle(free_cells.begin(), free_cells.end(), rng);
+
+    size_t next = 0;
+    auto place = [&](MarkerKind kind, uint8_t digit) {
+        int cell = free_cells[next++];
+        main.markers.push_back(Marker{kind, digit, static_cast<uint16_t>(cell % size), static_cast<uint16_t>(cell / size)});
+    };
+    place(MARKER_PLAYER, 0);
+    main.scene[free_cells[next++]] = CELL_PLAYER_TARGET;
+    int boxes = size * size / 50;
+    for (int i = 0; i < boxes; ++i) {
+        place(MARKER_BOX, 0);
+        main.scene[free_cells[next++]] = CELL_BOX_TARGET;
+    }
+
+    const int box_size = 7;
+    const int mid = box_size / 2;
+    for (int r = 1; r <= box_rooms; ++r) {
+        place(MARKER_BOXROOM, static_cast<uint8_t>(r));
+        Room& room = level.rooms[r];
+        room.size = box_size;
+        room.is_box = true;
+        room.scene.assign(box_size * box_size, CELL_WALL);
+        for (int y = 1; y < box_size - 1; ++y) {
+            for (int x = 1; x < box_size - 1; ++x) {
+                room.scene[y * box_size + x] = CELL_FLOOR;
+            }
+        }
+        room.entries = {{0, mid}, {box_size - 1, mid}, {mid, 0}, {mid, box_size - 1}};
+        for (const auto& entry: room.entries) {
+            room.scene[entry[0] * box_size + entry[1]] = CELL_FLOOR;
+        }
+        room.markers.push_back(Marker{MARKER_BOX, 0, 2, 2});
+    }
+
+    for (auto& room: level.rooms) {
+        room.indexEntries();
+    }
+    return level;
+}
+
+/// @brief Time 'run' until it has 'min_samples' samples and at least 'min_ns' in total, or 'max_samples'
+template <typename F>
+std::vector<double> sampleRepeatedly(F run, size_t min_samples, size_t max_samples, double min_ns)
+{
+    std::vector<double> samples;
+    double total = 0;
+    while (samples.size() < max_samples && (samples.size() < min_samples || total < min_ns)) {
+        auto start = Clock::now();
+        run();
+        samples.push_back(nanosecondsSince(start));
+        total += samples.back();
+    }
+    return samples;
+}
+
+/// @brief Steps per second of BatchSimulator running random moves in 'games' games
+double benchmarkBatch(const Level& level, size_t games, size_t moves)
+{
+    BatchSimulator batch(level, games);
+    std::mt19937 rng(12345);
+    std::vector<std::vector<Input>> inputs(8, std::vector<Input>(games));
+    for (auto& round: inputs) {
+        for (auto& input: round) {
+            input = static_cast<Input>(rng() & 3);
+        }
+    }
+
+    // at least as many game steps as the single-game walk, with resets left out of the timing
+    size_t steps = std::max<size_t>(16, moves / games);
+    double ns = 0;
+    for (size_t s = 0; s < steps; ++s) {
+        if (s % 64 == 63) {
+            batch.reset();
+        }
+        auto start = Clock::now();
+        batch.step(inputs[s % inputs.size()].data());
+        ns += nanosecondsSince(start);
+    }
+    return ns > 0 ? steps * games / (ns * 1e-9) : 0;
+}
+
+LevelReport benchmarkLevel(const std::string& name, const Level& level, const std::string& path, size_t moves, size_t batch_games)
+{
+    LevelReport report;
+    report.name = name;
+    report.rooms = static_cast<int>(level.rooms.size());
+    for (const auto& room: level.rooms) {
+        report.cells += room.size * room.size;
+    }
+
+    if (!path.empty()) {
+        report.load = summarize(sampleRepeatedly([&]() { LevelLoader::loadLevel(path); }, 20, 2000, 2e8));
+    }
+    report.construct = summarize(sampleRepeatedly([&]() { GamePlay game(level); }, 5, 2000, 2e8));
+
+    GamePlay game(level);
+    const GameState start = game.getCurrState();
+    report.objects = 1 + static_cast<int>(start.boxes.size() + start.boxrooms.size());
+
+    // a seeded random walk, restarted now and then so the undo journal stays small
+    const size_t restart_every = 4096;
+    const size_t copy_every = 64;
+    const size_t copy_batch = 16;
+    std::vector<double> operate_ns, update_ns, copy_ns;
+    operate_ns.reserve(moves);
+    update_ns.reserve(moves);
+    copy_ns.reserve(moves / copy_every + 1);
+    std::mt19937 rng(12345);
+    size_t move_allocs = 0;
+    size_t copy_allocs = 0;
+    size_t copies = 0;
+
+    for (size_t i = 0; i < moves; ++i) {
+        if (i % restart_every == 0) {
+            game.setState(start);
+        }
+        Input input = static_cast<Input>(rng() & 3);
+
+        size_t allocs = allocationCount.load(std::memory_order_relaxed);
+        auto t0 = Clock::now();
+        game.operate(input);
+        auto t1 = Clock::now();
+        game.updateState();
+        auto t2 = Clock::now();
+        move_allocs += allocationCount.load(std::memory_order_relaxed) - allocs;
+        operate_ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        update_ns.push_back(std::chrono::duration<double, std::nano>(t2 - t1).count());
+
+        if (i % copy_every == 0) {
+            allocs = allocationCount.load(std::memory_order_relaxed);
+            auto c0 = Clock::now();
+            for (size_t c = 0; c < copy_batch; ++c) {
+                GameState copy = game.getCurrState();
+                benchmarkSink = copy.hash;
+            }
+            copy_ns.push_back(nanosecondsSince(c0) / copy_batch);
+            copy_allocs += allocationCount.load(std::memory_order_relaxed) - allocs;
+            copies += copy_batch;
+        }
+    }
+    double walk_ns = 0;
+    for (size_t i = 0; i < operate_ns.size(); ++i) {
+        walk_ns += operate_ns[i] + update_ns[i];
+    }
+    report.operate = summarize(std::move(operate_ns));
+    report.update = summarize(std::move(update_ns));
+    report.state_copy = summarize(std::move(copy_ns));
+    report.allocs_per_move = moves ? static_cast<double>(move_allocs) / moves : 0;
+    report.allocs_per_copy = copies ? static_cast<double>(copy_allocs) / copies : 0;
+    report.moves_per_second = walk_ns > 0 ? moves / (walk_ns * 1e-9) : 0;
+
+    // every game keeps its own occupancy grid; keep the batch of a large level within 64 MiB
+    if (batch_games > 0) {
+        report.batch_games = std::min(batch_games, std::max<size_t>(1, (size_t(64) << 20) / (report.cells * sizeof(uint16_t))));
+        report.batch_steps_per_second = benchmarkBatch(level, report.batch_games, moves);
+    }
+    return report;
+}
+
+/// @brief Cost of one clock read, included in every per-call timing
+double clockOverheadNs()
+{
+    std::vector<double> samples;
+    for (int i = 0; i < 10000; ++i) {
+        auto start = Clock::now();
+        samples.push_back(nanosecondsSince(start));
+    }
+    return summarize(std::move(samples)).median;
+}
+
+std::string formatNs(double ns)
+{
+    char text[32];
+    if (ns < 1e3) {
+        std::snprintf(text, sizeof(text), "%.0f ns", ns);
+    }
+    else if (ns < 1e6) {
+        std::snprintf(text, sizeof(text), "%.1f us", ns / 1e3);
+    }
+    else {
+        std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+    }
+    return text;
+}
+
+void printText(const std::vector<LevelReport>& reports, double overhead)
+{
+    std::cout << "clock overhead " << formatNs(overhead) << " per timed call (included below)\n";
+    auto row = [](const char* label, const Summary& s) {
+        if (s.samples == 0) {
+            return;
+        }
+        char text[128];
+        std::snprintf(text, sizeof(text), "  %-12s median %10s   p99 %10s   mean %10s   (%zu samples)\n",
+                      label, formatNs(s.median).c_str(), formatNs(s.p99).c_str(), formatNs(s.mean).c_str(), s.samples);
+        std::cout << text;
+    };
+    for (const auto& r: reports) {
+        std::cout << r.name << ": " << r.rooms << " rooms, " << r.cells << " cells, " << r.objects << " objects\n";
+        row("load", r.load);
+        row("construct", r.construct);
+        row("operate", r.operate);
+        row("updateState", r.update);
+        row("state copy", r.state_copy);
+        char text[128];
+        std::snprintf(text, sizeof(text), "  allocations  %.2f per move, %.2f per state copy; %.0f moves/s\n",
+                      r.allocs_per_move, r.allocs_per_copy, r.moves_per_second);
+        std::cout << text;
+        if (r.batch_games > 0) {
+            std::snprintf(text, sizeof(text), "  batch        %.0f steps/s over %zu games\n", r.batch_steps_per_second, r.batch_games);
+            std::cout << text;
+        }
+    }
+}
+
+void printJson(const std::vector<LevelReport>& reports, double overhead)
+{
+    auto summary = [](const Summary& s) {
+        return nlohmann::ordered_json{{"samples", s.samples}, {"median_ns", s.median}, {"p99_ns", s.p99}, {"mean_ns", s.mean}};
+    };
+    nlohmann::ordered_json out;
+    out["clock_overhead_ns"] = overhead;
+    out["levels"] = nlohmann::ordered_json::array();
+    for (const auto& r: reports) {
+        nlohmann::ordered_json level = {
+            {"name", r.name},
+            {"rooms", r.rooms},
+            {"cells", r.cells},
+            {"objects", r.objects},
+            {"construct", summary(r.construct)},
+            {"operate", summary(r.operate)},
+            {"update_state", summary(r.update)},
+            {"state_copy", summary(r.state_copy)},
+            {"allocs_per_move", r.allocs_per_move},
+            {"allocs_per_state_copy", r.allocs_per_copy},
+            {"moves_per_second", r.moves_per_second},
+        };
+        if (r.load.samples) {
+            level["load"] = summary(r.load);
+        }
+        if (r.batch_games > 0) {
+            level["batch_games"] = r.batch_games;
+            level["batch_steps_per_second"] = r.batch_steps_per_second;
+        }
+        out["levels"].push_back(level);
+    }
+    std::cout << out.dump(2) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t moves = 200000;
+    bool as_json = false;
+    size_t batch_games = 16384;
+    bool synthetic = true;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--moves" && i + 1 < argc) {
+            moves = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--batch" && i + 1 < argc) {
+            batch_games = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--json") {
+            as_json = true;
+        }
+        else if (arg == "--no-synthetic") {
+            synthetic = false;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            printUsage();
+            return 2;
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty() && !synthetic) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<LevelReport> reports;
+    try {
+        for (const auto& path: paths) {
+            reports.push_back(benchmarkLevel(path, LevelLoader::loadLevel(path), path, moves, batch_games));
+        }
+        if (synthetic) {
+            for (int size: {32, 128}) {
+                std::string name = "synthetic-" + std::to_string(size);
+                reports.push_back(benchmarkLevel(name, makeSyntheticLevel(size, 3, size), "", moves, batch_games));
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    double overhead = clockOverheadNs();
+    if (as_json) {
+        printJson(reports, overhead);
+    }
+    else {
+        printText(reports, overhead);
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "level_loader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "Usage: compile_levels [--check] level.json|dir...\n";
+}
+
+bool sameLevel(const Level& a, const Level& b)
+{
+    if (a.id != b.id || a.room_num != b.room_num || a.rooms.size() != b.rooms.size()) {
+        return false;
+    }
+    for (size_t r = 0; r < a.rooms.size(); ++r) {
+        const Room& x = a.rooms[r];
+        const Room& y = b.rooms[r];
+        if (x.size != y.size || x.is_box != y.is_box || x.entries != y.entries || x.scene != y.scene
+            || x.markers.size() != y.markers.size()) {
+            return false;
+        }
+        for (size_t m = 0; m < x.markers.size(); ++m) {
+            if (x.markers[m].kind != y.markers[m].kind || x.markers[m].digit != y.markers[m].digit
+                || x.markers[m].x != y.markers[m].x || x.markers[m].y != y.markers[m].y) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// @brief Median wall-clock time of a call in microseconds
+template <typename F>
+double medianMicros(F&& f, int runs)
+{
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i) {
+        auto started = std::chrono::steady_clock::now();
+        f();
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count());
+    }
+    std::nth_element(times.begin(), times.begin() + runs / 2, times.end());
+    return times[runs / 2];
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool check = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--check") {
+            check = true;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            printUsage();
+            return 2;
+        }
+        else if (std::filesystem::is_directory(arg)) {
+            std::vector<std::string> found;
+            for (const auto& entry: std::filesystem::directory_iterator(arg)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".json") {
+                    found.push_back(entry.path().string());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    // exit status is non-zero if any level could not be compiled or does not read back unchanged
+    int status = 0;
+    for (const auto& path: paths) {
+        try {
+            std::string binary = LevelLoader::compileLevel(path);
+            std::cout << path << " -> " << binary << "\n";
+            if (!check) {
+                continue;
+            }
+
+            auto parseJson = [&]() {
+                std::ifstream file(path, std::ios::binary);
+                std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                return LevelLoader::parseLevel(text);
+            };
+            if (!sameLevel(parseJson(), LevelLoader::loadBinaryLevel(binary)) || !sameLevel(parseJson(), LevelLoader::loadLevel(path))) {
+                std::cout << "  MISMATCH between the JSON and the compiled level\n";
+                status = 1;
+                continue;
+            }
+            double json_us = medianMicros([&]() { parseJson(); }, 200);
+            double binary_us = medianMicros([&]() { LevelLoader::loadBinaryLevel(binary); }, 200);
+            double load_us = medianMicros([&]() { LevelLoader::loadLevel(path); }, 200);
+            std::cout << "  identical; JSON parse " << json_us << " us, binary load " << binary_us
+                      << " us, loadLevel " << load_us << " us\n";
+        }
+        catch (const std::exception& e) {
+            std::cerr << path << ": " << e.what() << "\n";
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,163 @@
+#include "level_generator.hpp"
+#include "level_loader.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "Usage: generate [--count N] [--out DIR] [--first-id N] [--seed N] [--threads N]\n"
+                 "                [--min-moves N] [--max-moves N] [--min-branching X] [--max-branching X]\n"
+                 "                [--max-boxes N] [--max-states N] [--max-candidates N]\n";
+}
+
+/// @brief Layout and initial placements of a level, to recognise duplicates
+std::string levelKey(const Level& level)
+{
+    std::string key;
+    for (const auto& room: level.rooms) {
+        key.append(room.scene.begin(), room.scene.end());
+        for (const auto& marker: room.markers) {
+            key += static_cast<char>(marker.kind);
+            key += static_cast<char>(marker.digit);
+            key += static_cast<char>(marker.x);
+            key += static_cast<char>(marker.y);
+        }
+        key += '/';
+    }
+    return key;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    GeneratorOptions options;
+    int count = 10;
+    std::string out_dir = "levels";
+    int first_id = 100;
+    uint64_t seed = 1;
+    int threads = 0;
+    size_t max_candidates = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            count = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--out" && i + 1 < argc) {
+            out_dir = argv[++i];
+        }
+        else if (arg == "--first-id" && i + 1 < argc) {
+            first_id = std::atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--min-moves" && i + 1 < argc) {
+            options.min_moves = std::atoi(argv[++i]);
+        }
+        else if (arg == "--max-moves" && i + 1 < argc) {
+            options.max_moves = std::atoi(argv[++i]);
+        }
+        else if (arg == "--min-branching" && i + 1 < argc) {
+            options.min_branching = std::atof(argv[++i]);
+        }
+        else if (arg == "--max-branching" && i + 1 < argc) {
+            options.max_branching = std::atof(argv[++i]);
+        }
+        else if (arg == "--max-boxes" && i + 1 < argc) {
+            options.max_boxes = std::max(options.min_boxes, std::atoi(argv[++i]));
+        }
+        else if (arg == "--max-states" && i + 1 < argc) {
+            options.max_states = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--max-candidates" && i + 1 < argc) {
+            max_candidates = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (max_candidates == 0) {
+        max_candidates = static_cast<size_t>(count) * 2000;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(out_dir, error);
+    if (error) {
+        std::cerr << out_dir << ": " << error.message() << "\n";
+        return 1;
+    }
+
+    // candidates are generated in rounds on all threads, each from seed + its index, and
+    // accepted in index order, so the output does not depend on the number of threads
+    WorkStealingPool pool(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    size_t round_size = static_cast<size_t>(pool.size()) * 16;
+    std::vector<std::optional<GeneratedLevel>> round(round_size);
+    std::set<std::string> seen;
+    size_t tried = 0;
+    int written = 0;
+    int next_id = first_id;
+    auto started = std::chrono::steady_clock::now();
+
+    while (written < count && tried < max_candidates) {
+        size_t batch = std::min(round_size, max_candidates - tried);
+        pool.run(batch, [&](int, size_t i) {
+            GeneratedLevel level;
+            if (generateLevel(options, seed + tried + i, level)) {
+                round[i] = std::move(level);
+            }
+            else {
+                round[i].reset();
+            }
+        });
+        tried += batch;
+
+        for (size_t i = 0; i < batch && written < count; ++i) {
+            if (!round[i] || !seen.insert(levelKey(round[i]->level)).second) {
+                continue;
+            }
+            std::filesystem::path path;
+            do {
+                path = std::filesystem::path(out_dir) / ("g" + std::to_string(next_id++) + ".json");
+            } while (std::filesystem::exists(path));
+
+            Level& level = round[i]->level;
+            level.id = next_id - 1;
+            try {
+                LevelLoader::saveLevel(level, path.string());
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
+            ++written;
+            std::cout << path.string() << "  moves " << round[i]->moves
+                      << "  branching " << std::fixed << std::setprecision(2) << round[i]->branching
+                      << "  states " << round[i]->states << "\n";
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << written << " levels from " << tried << " candidates in " << std::setprecision(1) << seconds
+              << " s (" << std::setprecision(0) << tried / std::max(seconds, 1e-9) << " candidates/s, "
+              << pool.size() << " threads)\n";
+    return written == count ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include "asset_archive.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "Usage: pack_assets [--out assets.ppak] [--check] file|dir...\n"
+                 "       pack_assets --list assets.ppak\n"
+                 "Assets are stored under their paths as given, so run it from the directory the game runs in:\n"
+                 "       pack_assets view/shader view/assest resource model/levels\n";
+}
+
+/// @brief The files named on the command line, directories expanded to every file below them
+/// @param skip The archive being written, left out if it lies in one of the directories
+std::vector<AssetSource> collectAssets(const std::vector<std::string>& args, const std::string& skip)
+{
+    std::vector<AssetSource> sources;
+    std::error_code error;
+    for (const auto& arg: args) {
+        if (!std::filesystem::is_directory(arg)) {
+            sources.push_back({arg, arg});
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto& entry: std::filesystem::recursive_directory_iterator(arg)) {
+            if (entry.is_regular_file() && !std::filesystem::equivalent(entry.path(), skip, error)) {
+                found.push_back(entry.path().generic_string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        for (const auto& path: found) {
+            sources.push_back({path, path});
+        }
+    }
+    return sources;
+}
+
+/// @brief Wall-clock time of a call in microseconds
+template <typename F>
+double micros(F&& f)
+{
+    auto started = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string out = Assets::DEFAULT_ARCHIVE;
+    std::string list;
+    bool check = false;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            out = argv[++i];
+        }
+        else if (arg == "--list" && i + 1 < argc) {
+            list = argv[++i];
+        }
+        else if (arg == "--check") {
+            check = true;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            printUsage();
+            return 2;
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+
+    try {
+        if (!list.empty()) {
+            AssetArchive archive;
+            archive.open(list);
+            for (const auto& name: archive.names()) {
+                std::cout << archive.find(name).size() << "\t" << name << "\n";
+            }
+            return 0;
+        }
+        if (args.empty()) {
+            printUsage();
+            return 2;
+        }
+
+        std::vector<AssetSource> sources = collectAssets(args, out);
+        AssetArchive::pack(sources, out);
+        size_t bytes = 0;
+        for (const auto& source: sources) {
+            bytes += Assets::read(source.path).size();
+        }
+        std::cout << sources.size() << " assets, " << bytes << " bytes -> " << out << " ("
+                  << std::filesystem::file_size(out) << " bytes)\n";
+        if (!check) {
+            return 0;
+        }
+
+        // every asset must read back unchanged; also compare one pass over the loose files with the archive
+        AssetArchive archive;
+        archive.open(out);
+        int status = 0;
+        for (const auto& source: sources) {
+            AssetData packed = archive.find(source.name);
+            AssetData loose = Assets::read(source.path);
+            if (!packed || packed.size() != loose.size()
+                || (loose.size() > 0 && std::memcmp(packed.data(), loose.data(), loose.size()) != 0)) {
+                std::cout << "  MISMATCH " << source.name << "\n";
+                status = 1;
+            }
+        }
+        double loose_us = micros([&]() {
+            for (const auto& source: sources) {
+                Assets::read(source.path);
+            }
+        });
+        double archive_us = micros([&]() {
+            AssetArchive mounted;
+            mounted.open(out);
+            for (const auto& source: sources) {
+                mounted.find(source.name);
+            }
+        });
+        std::cout << (status ? "  " : "  identical; ") << "opening every loose file " << loose_us
+                  << " us, mapping the archive and finding every asset " << archive_us << " us\n";
+        return status;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,120 @@
+#include "level_loader.hpp"
+#include "gameplay.hpp"
+#include "replay.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "Usage: replay [--levels DIR] [--repeat N] [--quiet] replay.ppr...\n";
+}
+
+/// @brief A loaded level shared by all replays played on it
+struct LoadedLevel
+{
+    std::unique_ptr<GamePlay> game;
+    GameState start;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string level_dir;
+    int repeat = 1;
+    bool quiet = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--levels" && i + 1 < argc) {
+            level_dir = argv[++i];
+        }
+        else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--quiet") {
+            quiet = true;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            printUsage();
+            return 2;
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    // levels are parsed once, and their GamePlay reused, however many replays use them
+    std::map<std::string, LoadedLevel> levels;
+    auto levelFor = [&](const std::string& recorded) -> LoadedLevel& {
+        std::string path = level_dir.empty() ? recorded
+                         : (std::filesystem::path(level_dir) / std::filesystem::path(recorded).filename()).string();
+        auto it = levels.find(path);
+        if (it == levels.end()) {
+            LoadedLevel loaded;
+            loaded.game = std::make_unique<GamePlay>(LevelLoader::loadLevel(path));
+            loaded.start = loaded.game->getCurrState();
+            it = levels.emplace(path, std::move(loaded)).first;
+        }
+        return it->second;
+    };
+
+    // exit status is non-zero if any replay could not be played or ended in a different state
+    int status = 0;
+    size_t played = 0;
+    size_t total_moves = 0;
+    double seconds = 0;
+    for (const auto& path: files) {
+        try {
+            Replay replay = ReplayFile::load(path);
+            LoadedLevel& level = levelFor(replay.level);
+
+            ReplayResult result;
+            auto begin = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeat; ++r) {
+                result = playReplay(*level.game, level.start, replay);
+            }
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            played += repeat;
+            total_moves += result.moves * repeat;
+
+            bool ok = result.start_matches && result.end_matches;
+            if (!ok) {
+                status = 1;
+            }
+            if (!ok || !quiet) {
+                std::cout << path << ": " << result.moves << " moves, "
+                          << (!result.start_matches ? "level changed since recording"
+                              : !result.end_matches ? "final state differs from the recording"
+                              : "ok")
+                          << (result.is_win ? ", won" : "") << "\n";
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << path << ": " << e.what() << "\n";
+            status = 1;
+        }
+    }
+
+    std::cout << played << " replays, " << total_moves << " moves, " << seconds << " s";
+    if (seconds > 0) {
+        std::cout << ", " << static_cast<size_t>(total_moves / seconds) << " moves/s";
+    }
+    std::cout << "\n";
+    return status;
+}
@@ -0,0 +1,85 @@
+#include "level_loader.hpp"
+#include "solver.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "Usage: solve [--bfs | --astar] [--bidirectional] [--threads N] [--max-states N] [--table-mb N] level.json...\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    SolverOptions options;
+    std::vector<std::string> levels;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bfs") {
+            options.algorithm = SOLVER_BFS;
+        }
+        else if (arg == "--astar") {
+            options.algorithm = SOLVER_ASTAR;
+        }
+        else if (arg == "--bidirectional") {
+            options.bidirectional = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--max-states" && i + 1 < argc) {
+            options.max_states = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--table-mb" && i + 1 < argc) {
+            options.table_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            printUsage();
+            return 2;
+        }
+        else {
+            levels.push_back(arg);
+        }
+    }
+    if (levels.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    // exit status is non-zero if any level could not be solved
+    int status = 0;
+    for (const auto& path: levels) {
+        try {
+            Level level = LevelLoader::loadLevel(path);
+            SolveResult result = solve(level, options);
+
+            std::cout << path << ": ";
+            if (result.solved) {
+                std::cout << "solved in " << result.moves.size() << " moves"
+                          << (result.optimal ? " (optimal)" : " (not proven optimal)") << "\n"
+                          << "  " << movesToString(result.moves) << "\n";
+            }
+            else {
+                std::cout << (result.exhausted ? "no solution\n"
+                              : result.table_full ? "gave up (state table full)\n"
+                              : "gave up (state limit reached)\n");
+                status = 1;
+            }
+            std::cout << "  " << result.states << " states, " << result.expanded << " expanded, "
+                      << result.seconds << " s, " << static_cast<size_t>(result.states_per_second) << " states/s, "
+                      << "peak memory " << result.peak_memory_bytes / (1024 * 1024) << " MiB"
+                      << (result.bidirectional ? ", bidirectional" : "") << "\n";
+        }
+        catch (const std::exception& e) {
+            std::cerr << path << ": " << e.what() << "\n";
+            status = 1;
+        }
+    }
+    return status;
+}
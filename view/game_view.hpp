@@ -10,6 +10,7 @@
 #include <cmath>
 #include <limits>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <fstream>
 #include <sstream>
@@ -24,6 +25,7 @@
 
 #include "model/include/gameplay.hpp"
 #include "model/include/level_loader.hpp"
+#include "model/include/asset_archive.hpp"
 #include "view/uimanager.hpp"
 #include "view/shader.hpp"
 #include "model/portal/portal.h"
@@ -179,7 +181,7 @@ public:
     }
 
     // 开始一次位移动画（用于玩家/箱子推进）
-    void beginMoveAnimation(float duration, Input input) {
+    void beginMoveAnimation(float duration, Input input, const std::vector<MoveEvent>& events) {
         // 缩短时长以提升轻快感，若调用者提供更短时长，可按调用者值
         const float preferred = 0.3f;
         //moveDuration_ = std::min(duration > 0.0f ? duration : preferred, preferred);
@@ -187,6 +189,16 @@ public:
         moveStartTime_ = static_cast<float>(glfwGetTime());
         moving_ = true;
         moveInput_ = input;
+        moveEvents_ = events;
+    }
+
+    // Event of the animated move for an entity, nullptr if the entity stays in place
+    const MoveEvent* findMoveEvent(CellType type, int id) const {
+        if (!moving_) return nullptr;
+        for (const auto& event : moveEvents_) {
+            if (event.object.type == type && event.object.id == id) return &event;
+        }
+        return nullptr;
     }
         
     Input remapInputForCamera(Input input) const {
@@ -198,7 +210,24 @@ public:
         return rotating_;
     }
 
-    void render(const GameState& state, const Level& level, const GameState& next_state) {
+    // 相机朝向（度）；旋转中返回目标朝向，用于存档
+    float cameraYaw() const {
+        return rotating_ ? rotateTargetYaw_ : cameraYaw_;
+    }
+
+    // 直接设置相机朝向（读档时恢复），取整到最近的 90 度并结束旋转
+    void setCameraYaw(float yaw) {
+        if (!std::isfinite(yaw)) yaw = 0.0f;
+        yaw = std::round(yaw / 90.0f) * 90.0f;
+        while (yaw > 180.0f) yaw -= 360.0f;
+        while (yaw < -180.0f) yaw += 360.0f;
+        cameraYaw_ = yaw;
+        rotateTargetYaw_ = yaw;
+        rotating_ = false;
+        cameraPitch_ = fixedPitch_;
+    }
+
+    void render(const GameState& state, const Level& level) {
         if (!basicShader_) return;
         if (level.rooms.empty()) return;
         
@@ -281,7 +310,7 @@ public:
         //        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
         //        glClear(GL_COLOR_BUFFER_BIT);
 
-        //        renderRoomIndex(static_cast<int>(i), state, level, next_state, moveT/*, true*/);
+        //        renderRoomIndex(static_cast<int>(i), state, level, moveT/*, true*/);
 
         //        glBindTexture(GL_TEXTURE_2D, 0);
         //        glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -307,15 +336,15 @@ public:
                     continue;
                 }
 
-                // 1. Get boxroom ID, start pos & end pos
+                // 1. Get boxroom ID, start pos & end pos (only a boxroom with a move event changes)
                 int boxroomID = portal->boxroomID;
                 auto start = state.boxrooms.find(boxroomID);
-                auto end = next_state.boxrooms.find(boxroomID);
-                if (start == state.boxrooms.end() || end == next_state.boxrooms.end()) {
+                if (start == state.boxrooms.end()) {
                     continue;
                 }
+                const MoveEvent* event = findMoveEvent(BOXROOM, boxroomID);
                 const Pos& startPos = start->second;
-                const Pos& endPos = end->second;
+                const Pos& endPos = event ? event->to : startPos;
 
                 // 2. Get world coordinate of the portal at start & end
                 glm::vec3 startWorldPos = computePortalPosition(level.rooms[startPos.room], startPos.x, startPos.y, portal->relativePos, tileWorldSize_, portalHeight);
@@ -341,7 +370,7 @@ public:
             glm::mat4 cameraView = getCameraView(level.rooms[state.player.room], tileWorldSize_);
             glm::mat4 skyboxView = getCameraView(level.rooms[state.player.room], tileWorldSize_, 1.25f, 4.0f);
             for (const auto& portal : portalsToRender) {
-                renderPortalRecursive(portal, cameraView, skyboxView, 2, state, level, next_state, moveT, true);
+                renderPortalRecursive(portal, cameraView, skyboxView, 2, state, level, moveT, true);
             }
 
             // Render scene: now use renderRoomIndexWithPortals
@@ -349,7 +378,7 @@ public:
             glViewport(0, 0, windowWidth_, windowHeight_);
             glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT);
-            renderRoomIndexWithPortals(state.player.room, portalsToRender, nullptr, state, level, next_state, moveT, true);
+            renderRoomIndexWithPortals(state.player.room, portalsToRender, nullptr, state, level, moveT, true);
         }
     }
 
@@ -467,6 +496,17 @@ public:
 
         portalsList.push_back(portalOutside);
         portalsList.push_back(portalInBox);
+
+        // 按 (箱房, 入口格) 建立查找表，入口格上的箱内传送门可 O(1) 取得，其 pairPortal 即箱外传送门
+        if (entryPortals_.size() <= static_cast<size_t>(boxroomID)) {
+            entryPortals_.resize(boxroomID + 1);
+        }
+        EntryPortals& table = entryPortals_[boxroomID];
+        if (table.byCell.empty()) {
+            table.size = boxroom.size;
+            table.byCell.assign(static_cast<size_t>(boxroom.size) * boxroom.size, nullptr);
+        }
+        table.byCell[y * boxroom.size + x] = portalInBox;
     }
 
     void clearPortals(void) {
@@ -474,6 +514,15 @@ public:
             delete portal;
         }
         portalsList.clear();
+        entryPortals_.clear();
+    }
+
+    // 位于某箱房入口格上的箱内传送门，没有则返回 nullptr
+    Portal* entryPortalAt(const Pos& pos) const {
+        if (pos.room < 0 || static_cast<size_t>(pos.room) >= entryPortals_.size()) return nullptr;
+        const EntryPortals& table = entryPortals_[pos.room];
+        if (pos.x < 0 || pos.y < 0 || pos.x >= table.size || pos.y >= table.size) return nullptr;
+        return table.byCell[pos.y * table.size + pos.x];
     }
 
     void resetCamera() {
@@ -510,7 +559,8 @@ private:
     GLuint loadTexture2D(const char* path) {
         int w = 0, h = 0, n = 0;
         stbi_set_flip_vertically_on_load(1);
-        unsigned char* data = stbi_load(path, &w, &h, &n, 0);
+        AssetData file = Assets::read(path);
+        unsigned char* data = file ? stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &w, &h, &n, 0) : nullptr;
         if (!data) {
             std::cerr << "Failed to load texture: " << path << std::endl;
             return 0;
@@ -642,10 +692,10 @@ private:
         glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
     }
 
-    // 新增：支持插值渲染，依据 state 与 next_state 以及 moveT
+    // 新增：支持插值渲染，依据 state、本次移动事件以及 moveT
     // Now features model matrix (basicShader_), clip plane toggling and virtual view toggling
     // New: more clipping planes for passing-through-portal rendering
-    void renderRoomIndex(int roomId, const GameState& state, const Level& level, const GameState& next_state, float moveT, /*bool rebuild = true,*/
+    void renderRoomIndex(int roomId, const GameState& state, const Level& level, float moveT, /*bool rebuild = true,*/
                          bool enableClip = false, glm::vec4 clipPlane = glm::vec4(0.0f), bool enableVirtualView = false, glm::mat4 virtualView = glm::mat4(0.0f), glm::mat4 virtualSkyboxView = glm::mat4(0.0f))
     {
         if (roomId < 0 || roomId >= static_cast<int>(level.rooms.size())) return;
@@ -660,7 +710,7 @@ private:
         glm::mat4 viewSkyboxToUse = enableVirtualView ? virtualSkyboxView : getCameraView(room, tileWorldSize_, 1.25f, 4.0f);
 
         moveDirection_ = glm::vec2(0.0f); // 默认无方向（用于非移动或非本房间）
-        appendRoomGeometry(room, roomId, state, next_state, moveT, tileWorldSize_, enableVirtualView);
+        appendRoomGeometry(room, roomId, state, moveT, tileWorldSize_, enableVirtualView);
         
         glm::vec3 roomCenter = glm::vec3(0.0f, 0.02f, 0.0f);
         glm::mat4 model = glm::mat4(1.0f);
@@ -1080,7 +1130,7 @@ private:
         return cameraPosition_;
     }
 
-    float appendRoomGeometry(const Room& room, int roomId, const GameState& state, const GameState& next_state, float moveT, float tileSize, bool wallCullOverride = false) {
+    float appendRoomGeometry(const Room& room, int roomId, const GameState& state, float moveT, float tileSize, bool wallCullOverride = false) {
         const int tileCount = room.size;
         const float boardHalf = tileCount * tileSize * 0.5f;
 
@@ -1356,7 +1406,7 @@ private:
         // 判定某墙格到外部的直线路径上是否全为墙，用于让窗洞贯穿厚墙
         auto isWallCell = [&](int gx, int gy) -> bool {
             if (gx < 0 || gx >= tileCount || gy < 0 || gy >= tileCount) return false;
-            return room.scene[gy][gx] == "#";
+            return room.cellAt(gx, gy) == CELL_WALL;
         };
         
         auto hasExteriorWallPath = [&](int gx, int gy) -> bool {
@@ -1477,11 +1527,12 @@ private:
         for (int y = 0; y < tileCount; ++y) {
             for (int x = 0; x < tileCount; ++x) {
                 auto bounds = boundsForCell(x, y);
-                glm::vec3 baseColor = tileColorForCell(room.scene[y][x]);
+                CellKind cell = room.cellAt(x, y);
+                glm::vec3 baseColor = tileColorForCell(cell);
                 appendFloor(floorVertexData_, bounds[0], bounds[1], bounds[2], bounds[3], baseColor);
                 glm::vec3 camPos = cameraPosition_;
 
-                if (room.scene[y][x] == "#") {
+                if (cell == CELL_WALL) {
                     if (windowMap[y][x] && !camera_in_wall(bounds[0], bounds[1], bounds[2], bounds[3])) {
                         appendWindowWall(wallVertexData_, x, y, bounds[0], bounds[1], bounds[2], bounds[3], 0.0f, wallHeight_, glm::vec3(RGB_2_FLT(0xF4CFE9)));
                     } else {
@@ -1491,76 +1542,32 @@ private:
                             appendWallPart(wallVertexData_, bounds[0], bounds[1], bounds[2], bounds[3], 0.0f, 1.0f, glm::vec3(RGB_2_FLT(0xF4CFE9)));
                         }
                     }
-                } else if (room.scene[y][x] == "|") {
+                } else if (cell == CELL_PORTAL_WALL) {
                     appendChair(x, y);
                 }
             }
         }
 
-        // Determine whether the obj. is going through a portal
-        auto isPassingThroughPortal = [&](const Pos& s, const Pos& e) {
-            if (!moving_ || (s.room != roomId && e.room != roomId)) {
-                // Player not moving, or neither end is in cur. room
-                return false;
-            }
-            else if (s.room != e.room) {
-                // Ends not in the same room, certainly going through a portal
-                return true;
-            }
-            else {
-                // Ends in the same room, but might be going through a portal
-                // Determine by judging whether movement is continuous, or not moving at all
-                int dx = e.x - s.x;
-                int dy = e.y - s.y;
-                if ((moveInput_ == UP && dx == 0 && dy == -1) ||
-                    (moveInput_ == DOWN && dx == 0 && dy == 1) ||
-                    (moveInput_ == LEFT && dx == -1 && dy == 0) ||
-                    (moveInput_ == RIGHT && dx == 1 && dy == 0) ||
-                    (dx == 0 && dy == 0))
-                {
-                    return false;
-                }
-                else {
-                    return true;
-                }
-            }
+        // Determine whether the obj. is going through a portal: its move event crossed an entry
+        auto isPassingThroughPortal = [&](const MoveEvent* event) {
+            return event && event->portal.has_value() && (event->from.room == roomId || event->to.room == roomId);
         };
 
-        auto getPassingThroughPortal = [&](const Pos& curPos) {
-            Portal* target = nullptr;
-
-            int dx = 0, dy = 0;
-            switch (moveInput_) {
-                case UP: dy = -1; break;
-                case DOWN: dy = 1; break;
-                case LEFT: dx = -1; break;
-                case RIGHT: dx = 1; break;
-            }
-
-            for (const auto& portal : portalsList) {
-                if (portal->getPortalPos(state.boxrooms) == curPos) {
-                    // Currently at entry, only 1 portal per entry
-                    target = portal;
-                    break;
-                }
-                else if (Pos(curPos.room, curPos.x + dx, curPos.y + dy) == portal->getPortalPos(state.boxrooms) &&
-                        ((moveInput_ == UP && portal->relativePos == ZNeg) ||
-                         (moveInput_ == DOWN && portal->relativePos == ZPos) ||
-                         (moveInput_ == LEFT && portal->relativePos == XPos) ||
-                         (moveInput_ == RIGHT && portal->relativePos == XNeg)))
-                {
-                    target = portal;
-                    break;
-                }
+        // Portal on the start side of a crossing: the inner portal of the entry the object stands on
+        // when it leaves a box room, otherwise the outer portal of the entry recorded by its move event
+        auto getPassingThroughPortal = [&](const Pos& curPos, const MoveEvent* event) -> Portal* {
+            if (Portal* leaving = entryPortalAt(curPos)) {
+                return leaving;
             }
-
-            return target;
+            Portal* entered = entryPortalAt(*event->portal);
+            return entered ? entered->pairPortal : nullptr;
         };
 
         // 计算玩家插值 + 设置运动方向
         auto drawPlayer = [&]() {
+            const MoveEvent* event = findMoveEvent(PLAYER, -1);
             const Pos& s = state.player;
-            const Pos& e = next_state.player;
+            const Pos& e = event ? event->to : s;
             glm::vec3 color(RGB_2_FLT(0x008B45));
             float height = 0.90f;
 
@@ -1571,8 +1578,8 @@ private:
                 idleT = std::fmod(now, idleDuration_) / idleDuration_;
             }
 
-            if (isPassingThroughPortal(s, e)) {
-                Portal* sPortal = getPassingThroughPortal(s);
+            if (isPassingThroughPortal(event)) {
+                Portal* sPortal = getPassingThroughPortal(s, event);
 
                 // Store relevant info
                 objThroughPortalData.exists = true;
@@ -1661,99 +1668,92 @@ private:
         };
 
         // 计算箱子插值（保持基础几何）
-        auto drawBoxes = [&](std::map<int, Pos> boxes, std::map<int, Pos> next_boxes, glm::vec3 color, bool isBoxroom = false) {
+        auto drawBoxes = [&](const std::map<int, Pos>& boxes, CellType type, glm::vec3 color, bool isBoxroom = false) {
             for (const auto& kv : boxes) {
                 int id = kv.first;
                 const Pos& s = kv.second;
                 float height = isBoxroom ? portalHeight : 0.96f;
 
-                auto it = next_boxes.find(id);
-                if (it != next_boxes.end()) {
-                    const Pos& e = it->second;
+                // 仅对本次移动中产生事件的实体做插值
+                const MoveEvent* event = findMoveEvent(type, id);
+                const Pos& e = event ? event->to : s;
 
-                    if (isPassingThroughPortal(s, e)) {
-                        Portal* sPortal = getPassingThroughPortal(s);
+                if (isPassingThroughPortal(event)) {
+                    Portal* sPortal = getPassingThroughPortal(s, event);
 
-                        // Store relevant info
-                        objThroughPortalData.exists = true;
-                        objThroughPortalData.isPlayer = false;
-                        objThroughPortalData.portal = (s.room == roomId) ? sPortal : sPortal->pairPortal;
-                        
-                        // If the box is being teleported to the same room, draw twice
-                        // The render function will handle drawing the two obj.s
-                        if (s.room == e.room) {
-                            objThroughPortalData.renderTwice = true;
+                    // Store relevant info
+                    objThroughPortalData.exists = true;
+                    objThroughPortalData.isPlayer = false;
+                    objThroughPortalData.portal = (s.room == roomId) ? sPortal : sPortal->pairPortal;
+                    
+                    // If the box is being teleported to the same room, draw twice
+                    // The render function will handle drawing the two obj.s
+                    if (s.room == e.room) {
+                        objThroughPortalData.renderTwice = true;
+                    }
+
+                    if (s.room == roomId) {
+                        // Calculate "supposedly" position and draw the box
+                        int dxs = 0, dys = 0;
+                        switch (moveInput_) {
+                        case UP: dys = -1; break;
+                        case DOWN: dys = 1; break;
+                        case LEFT: dxs = -1; break;
+                        case RIGHT: dxs = 1; break;
                         }
 
-                        if (s.room == roomId) {
-                            // Calculate "supposedly" position and draw the box
-                            int dxs = 0, dys = 0;
-                            switch (moveInput_) {
-                            case UP: dys = -1; break;
-                            case DOWN: dys = 1; break;
-                            case LEFT: dxs = -1; break;
-                            case RIGHT: dxs = 1; break;
-                            }
+                        glm::vec2 csNow = centerForCell(s.x, s.y);
+                        glm::vec2 csNext = centerForCell(s.x + dxs, s.y + dys);
+                        glm::vec2 cs = csNow + (csNext - csNow) * moveT;
 
-                            glm::vec2 csNow = centerForCell(s.x, s.y);
-                            glm::vec2 csNext = centerForCell(s.x + dxs, s.y + dys);
-                            glm::vec2 cs = csNow + (csNext - csNow) * moveT;
+                        drawAtCenter(cs, color, height, true);
+                    }
 
-                            drawAtCenter(cs, color, height, true);
+                    if (e.room == roomId) {
+                        // Calculate "supposedly" position before exiting pairPortal (of sPortal) and draw the box
+                        int dxe = 0, dye = 0;
+                        switch (objThroughPortalData.portal->pairPortal->relativePos) {
+                            case XPos: dxe = sPortal->pairPortal->stationary ? 1 : -1; break;
+                            case XNeg: dxe = sPortal->pairPortal->stationary ? -1 : 1; break;
+                            case ZPos: dye = sPortal->pairPortal->stationary ? -1 : 1; break;
+                            case ZNeg: dye = sPortal->pairPortal->stationary ? 1 : -1; break;
                         }
 
-                        if (e.room == roomId) {
-                            // Calculate "supposedly" position before exiting pairPortal (of sPortal) and draw the box
-                            int dxe = 0, dye = 0;
-                            switch (objThroughPortalData.portal->pairPortal->relativePos) {
-                                case XPos: dxe = sPortal->pairPortal->stationary ? 1 : -1; break;
-                                case XNeg: dxe = sPortal->pairPortal->stationary ? -1 : 1; break;
-                                case ZPos: dye = sPortal->pairPortal->stationary ? -1 : 1; break;
-                                case ZNeg: dye = sPortal->pairPortal->stationary ? 1 : -1; break;
-                            }
+                        glm::vec2 ceNow = centerForCell(e.x + dxe, e.y + dye);
+                        glm::vec2 ceNext = centerForCell(e.x, e.y);
+                        glm::vec2 ce = ceNow + (ceNext - ceNow) * moveT;
 
-                            glm::vec2 ceNow = centerForCell(e.x + dxe, e.y + dye);
-                            glm::vec2 ceNext = centerForCell(e.x, e.y);
-                            glm::vec2 ce = ceNow + (ceNext - ceNow) * moveT;
-
-                            drawAtCenter(ce, color, height, true);
-                        }
-                    }
-                    else if (s.room == roomId && e.room == roomId && (s.x != e.x || s.y != e.y) && moving_) {
-                        glm::vec2 cs = centerForCell(s.x, s.y);
-                        glm::vec2 ce = centerForCell(e.x, e.y);
-                        glm::vec2 c = cs + (ce - cs) * moveT;
-                        drawAtCenter(c, color, height);
-                    }
-                    else if (s.room == roomId && (!moving_ || (s.room != e.room || (s.x == e.x && s.y == e.y)))) {
-                        glm::vec2 c = centerForCell(s.x, s.y);
-                        drawAtCenter(c, color, height);
-                    }
-                    else if (!moving_ && e.room == roomId) {
-                        glm::vec2 c = centerForCell(e.x, e.y);
-                        drawAtCenter(c, color, height);
-                    }
-                } else {
-                    // 目标状态中不存在该箱子（例如被传送/消失），保持当前显示（非动画）
-                    if (s.room == roomId) {
-                        glm::vec2 c = centerForCell(s.x, s.y);
-                        drawAtCenter(c, color, height);
+                        drawAtCenter(ce, color, height, true);
                     }
                 }
+                else if (s.room == roomId && e.room == roomId && (s.x != e.x || s.y != e.y) && moving_) {
+                    glm::vec2 cs = centerForCell(s.x, s.y);
+                    glm::vec2 ce = centerForCell(e.x, e.y);
+                    glm::vec2 c = cs + (ce - cs) * moveT;
+                    drawAtCenter(c, color, height);
+                }
+                else if (s.room == roomId && (!moving_ || (s.room != e.room || (s.x == e.x && s.y == e.y)))) {
+                    glm::vec2 c = centerForCell(s.x, s.y);
+                    drawAtCenter(c, color, height);
+                }
+                else if (!moving_ && e.room == roomId) {
+                    glm::vec2 c = centerForCell(e.x, e.y);
+                    drawAtCenter(c, color, height);
+                }
             }
         };
 
-        drawBoxes(state.boxes, next_state.boxes, glm::vec3(RGB_2_FLT(0xCFD6F4)));
-        drawBoxes(state.boxrooms, next_state.boxrooms, glm::vec3(RGB_2_FLT(0xCFF4ED)), true);
+        drawBoxes(state.boxes, BOX, glm::vec3(RGB_2_FLT(0xCFD6F4)));
+        drawBoxes(state.boxrooms, BOXROOM, glm::vec3(RGB_2_FLT(0xCFF4ED)), true);
         drawPlayer();
 
         return boardHalf;
     }
 
-    glm::vec3 tileColorForCell(const std::string& cell) const {
-        if (cell == "#") return glm::vec3(RGB_2_FLT(0xF4CFE9));
-        if (cell == "=") return {0.25f, 0.6f, 0.3f};
-        if (cell == "_") return {0.7f, 0.6f, 0.25f};
+    glm::vec3 tileColorForCell(CellKind cell) const {
+        if (cell == CELL_WALL) return glm::vec3(RGB_2_FLT(0xF4CFE9));
+        if (cell == CELL_PLAYER_TARGET) return {0.25f, 0.6f, 0.3f};
+        if (cell == CELL_BOX_TARGET) return {0.7f, 0.6f, 0.25f};
         return {0.9f, 0.9f, 1.0f};
     }
 
@@ -1791,11 +1791,12 @@ private:
     }
 
     void loadModel(const std::string& path, std::vector<float>& outData, glm::vec3 color) {
-        std::ifstream file(path);
-        if (!file.is_open()) {
+        AssetData file = Assets::read(path);
+        if (!file) {
             std::cerr << "Failed to open model file: " << path << std::endl;
             return;
         }
+        std::string_view text = file.text();
 
         std::vector<glm::vec3> temp_pos;
         std::vector<glm::vec3> temp_norm;
@@ -1805,7 +1806,10 @@ private:
         std::vector<VertexIdx> indices;
 
         std::string line;
-        while (std::getline(file, line)) {
+        for (size_t start = 0; start < text.size();) {
+            size_t end = std::min(text.find('\n', start), text.size());
+            line.assign(text.substr(start, end - start));
+            start = end + 1;
             if (line.empty() || line[0] == '#') continue;
             std::stringstream ss(line);
             std::string type;
@@ -1940,7 +1944,7 @@ private:
 
     // New: Render the scene with portals
     // The portals to be rendered are given in portalsToRender.
-    void renderRoomIndexWithPortals(int roomId, std::vector<Portal*> portalsToRender, Portal* checkCurrent, const GameState& state, const Level& level, const GameState& next_state, float moveT, bool useFinal = false,
+    void renderRoomIndexWithPortals(int roomId, std::vector<Portal*> portalsToRender, Portal* checkCurrent, const GameState& state, const Level& level, float moveT, bool useFinal = false,
         bool enableClip = false, glm::vec4 clipPlane = glm::vec4(0.0f), bool enableVirtualView = false, glm::mat4 virtualView = glm::mat4(0.0f), glm::mat4 virtualSkyboxView = glm::mat4(0.0f))
     {
         if (roomId < 0 || roomId >= static_cast<int>(level.rooms.size())) return;
@@ -1949,7 +1953,7 @@ private:
         glm::mat4 viewToUse = enableVirtualView ? virtualView : getCameraView(room, tileWorldSize_, 1.0f, 3.0f);
 
         // Render the rest of the room first, without portals
-        renderRoomIndex(roomId, state, level, next_state, moveT,
+        renderRoomIndex(roomId, state, level, moveT,
             enableClip, clipPlane,
             enableVirtualView, virtualView, virtualSkyboxView);
 
@@ -2000,7 +2004,7 @@ private:
     // currentPortal: The portal currently being rendered
     // view: Current view matrix to observe the current portal
     // depth: Remaining recursion depth
-    void renderPortalRecursive(Portal* currentPortal, glm::mat4 view, glm::mat4 skyboxView, int depth, const GameState& state, const Level& level, const GameState& next_state, float moveT, bool final = false) {
+    void renderPortalRecursive(Portal* currentPortal, glm::mat4 view, glm::mat4 skyboxView, int depth, const GameState& state, const Level& level, float moveT, bool final = false) {
         // Between a pair of portals, the recursion *only* updates the texture of the *current* portal!
         // The other portal is always used as a view point, and is NEVER visible!
 
@@ -2019,7 +2023,7 @@ private:
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             // Render the scene without portals
-            renderRoomIndex(pairPortal->getPortalPos(state.boxrooms).room, state, level, next_state, moveT,
+            renderRoomIndex(pairPortal->getPortalPos(state.boxrooms).room, state, level, moveT,
                 true, currentPortal->getPairPortalClippingPlane(),
                 true, virtualView, virtualSkyboxView);
 
@@ -2048,7 +2052,7 @@ private:
 
         int nextDepth = std::max(depth - static_cast<int>(portalsToRender.size()), 0);
         for (const auto& portal : portalsToRender) {
-            renderPortalRecursive(portal, virtualView, virtualSkyboxView, nextDepth, state, level, next_state, moveT);
+            renderPortalRecursive(portal, virtualView, virtualSkyboxView, nextDepth, state, level, moveT);
         }
 
         // 3. Texture Copy (Optional)
@@ -2082,7 +2086,7 @@ private:
 
         // 5. Render the Scene
         // Draw other scene obj.s and all portals in the room
-        renderRoomIndexWithPortals(pairRoomID, portalsToRender, currentPortal, state, level, next_state, moveT, false,
+        renderRoomIndexWithPortals(pairRoomID, portalsToRender, currentPortal, state, level, moveT, false,
             true, currentPortal->getPairPortalClippingPlane(),
             true, virtualView, virtualSkyboxView);
 
@@ -2227,6 +2231,7 @@ private:
     // 位移动画状态（玩家/箱子）
     bool moving_ = false;
     Input moveInput_ = UP;
+    std::vector<MoveEvent> moveEvents_;    // 当前位移动画对应的移动事件
     float moveDuration_ = 0.0f;
     float moveStartTime_ = 0.0f;
     
@@ -2238,6 +2243,13 @@ private:
 
     // New: portals
     std::vector<Portal*> portalsList;
+
+    // 每个箱房的入口格 -> 箱内传送门（行主序，边长 size）
+    struct EntryPortals {
+        int size = 0;
+        std::vector<Portal*> byCell;
+    };
+    std::vector<EntryPortals> entryPortals_;
     std::unique_ptr<Shader> portalSurfaceShader_;
 
     GameState lastState_;
@@ -2278,12 +2290,10 @@ public:
         initialized_ = false;
     }
 
-    void render(const GameState* state, const Level* level, const GameState* next_state = nullptr) {
+    void render(const GameState* state, const Level* level) {
         bool renderedScene = false;
         if (showGameScene_ && state && level) {
-            // 容错：若未提供 next_state，则使用 state 自身
-            const GameState& nextRef = next_state ? *next_state : *state;
-            renderer_.render(*state, *level, nextRef);
+            renderer_.render(*state, *level);
             renderedScene = true;
         }
         if (!renderedScene) {
@@ -2347,8 +2357,16 @@ public:
         return renderer_.isRotating();
     }
 
-    void beginMoveAnimation(float duration, Input input) {
-        renderer_.beginMoveAnimation(duration, input);
+    float cameraYaw() const {
+        return renderer_.cameraYaw();
+    }
+
+    void setCameraYaw(float yaw) {
+        renderer_.setCameraYaw(yaw);
+    }
+
+    void beginMoveAnimation(float duration, Input input, const std::vector<MoveEvent>& events) {
+        renderer_.beginMoveAnimation(duration, input, events);
     }
 
     // Call from GLFW fb resize callback
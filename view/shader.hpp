@@ -7,11 +7,12 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
 #include <iostream>
 #include <filesystem>
 
+#include "model/include/asset_archive.hpp"
+
 class Shader
 {
 public:
@@ -21,107 +22,61 @@ public:
     Shader(const char* vertexPath, const char* fragmentPath,
         const char* tscPath = NULL, const char* tesPath = NULL)
     {
-        if (!(std::filesystem::exists(vertexPath)) || !(std::filesystem::exists(fragmentPath)))
-        {
-            std::cout << "ERROR::FILE_DOES_NOT_EXIST in " << std::filesystem::current_path() << std::endl;
-        }
-        if (tscPath != NULL && !std::filesystem::exists(tscPath))
-        {
-            std::cout << "WARNING::TESS_CONTROL_SHADER_FILE_DOES_NOT_EXIST: " << tscPath << std::endl;
-            tscPath = NULL;
-        }
-        if (tesPath != NULL && !std::filesystem::exists(tesPath))
+        // 1. retrieve the vertex/fragment (and optional tessellation) source code through Assets:
+        //    a view into the asset archive or a mapping of the file, never copied
+        AssetData vertexCode = Assets::read(vertexPath);
+        AssetData fragmentCode = Assets::read(fragmentPath);
+        if (!vertexCode || !fragmentCode)
         {
-            std::cout << "WARNING::TESS_EVALUATION_SHADER_FILE_DOES_NOT_EXIST: " << tesPath << std::endl;
-            tesPath = NULL;
+            std::cout << "ERROR::FILE_DOES_NOT_EXIST: " << (!vertexCode ? vertexPath : fragmentPath)
+                << " in " << std::filesystem::current_path() << std::endl;
         }
-
-        // 1. retrieve the vertex/fragment (and optional tessellation) source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string tcsCode;
-        std::string tesCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream tcsShaderFile;
-        std::ifstream tesShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
+        AssetData tcsCode;
+        AssetData tesCode;
+        if (tscPath != NULL)
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-
-            // read tessellation control shader if provided
-            if (tscPath != NULL)
+            tcsCode = Assets::read(tscPath);
+            if (!tcsCode)
             {
-                tcsShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-                tcsShaderFile.open(tscPath);
-                std::stringstream tcsShaderStream;
-                tcsShaderStream << tcsShaderFile.rdbuf();
-                tcsShaderFile.close();
-                tcsCode = tcsShaderStream.str();
-            }
-
-            // read tessellation evaluation shader if provided
-            if (tesPath != NULL)
-            {
-                tesShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-                tesShaderFile.open(tesPath);
-                std::stringstream tesShaderStream;
-                tesShaderStream << tesShaderFile.rdbuf();
-                tesShaderFile.close();
-                tesCode = tesShaderStream.str();
+                std::cout << "WARNING::TESS_CONTROL_SHADER_FILE_DOES_NOT_EXIST: " << tscPath << std::endl;
             }
         }
-        catch (std::ifstream::failure& e)
+        if (tesPath != NULL)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            tesCode = Assets::read(tesPath);
+            if (!tesCode)
+            {
+                std::cout << "WARNING::TESS_EVALUATION_SHADER_FILE_DOES_NOT_EXIST: " << tesPath << std::endl;
+            }
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        const char* tcsShaderCode = tcsCode.empty() ? NULL : tcsCode.c_str();
-        const char* tesShaderCode = tesCode.empty() ? NULL : tesCode.c_str();
 
         // 2. compile shaders
         unsigned int vertex, fragment, tcs = 0, tes = 0;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        setSource(vertex, vertexCode);
         glCompileShader(vertex);
         checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        setSource(fragment, fragmentCode);
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
 
         // optional tessellation control shader
-        if (tcsShaderCode != NULL)
+        if (tcsCode)
         {
             tcs = glCreateShader(GL_TESS_CONTROL_SHADER);
-            glShaderSource(tcs, 1, &tcsShaderCode, NULL);
+            setSource(tcs, tcsCode);
             glCompileShader(tcs);
             checkCompileErrors(tcs, "TESS_CONTROL");
         }
 
         // optional tessellation evaluation shader
-        if (tesShaderCode != NULL)
+        if (tesCode)
         {
             tes = glCreateShader(GL_TESS_EVALUATION_SHADER);
-            glShaderSource(tes, 1, &tesShaderCode, NULL);
+            setSource(tes, tesCode);
             glCompileShader(tes);
             checkCompileErrors(tes, "TESS_EVALUATION");
         }
@@ -209,6 +164,15 @@ public:
     }
 
 private:
+    // hand the source to GL with its length, as it is not null-terminated
+    // ------------------------------------------------------------------------
+    void setSource(unsigned int shader, const AssetData& code)
+    {
+        std::string_view text = code.text();
+        const char* source = text.empty() ? "" : text.data();
+        GLint length = static_cast<GLint>(text.size());
+        glShaderSource(shader, 1, &source, &length);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
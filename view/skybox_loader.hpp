@@ -1,4 +1,4 @@
-#ifndef SKYBOX_H
+﻿#ifndef SKYBOX_H
 #define SKYBOX_H
 
 #include <glad/glad.h>
@@ -35,7 +35,9 @@ public:
         stbi_set_flip_vertically_on_load(false);
         for (unsigned int i = 0; i < faces.size(); i++)
         {
-            unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+            // decode straight from the asset archive (or the mapped file), without reading it into a buffer
+            AssetData face = Assets::read(faces[i]);
+            unsigned char* data = face ? stbi_load_from_memory(face.data(), static_cast<int>(face.size()), &width, &height, &nrChannels, 0) : nullptr;
             if (data)
             {
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
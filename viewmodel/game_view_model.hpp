@@ -2,74 +2,69 @@
 #define GAME_VIEW_MODEL_HPP
 
 #include <array>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
 
+#include "model/include/embedded_levels.hpp"
 #include "model/include/gameplay.hpp"
 #include "model/include/level_loader.hpp"
+#include "model/include/session.hpp"
+#include "viewmodel/hint_service.hpp"
 
 // GameViewModel coordinates model state (GamePlay) for the view layer.
 /// Bridge between the view layer and the core gameplay logic. Responsible for
 /// loading levels, forwarding inputs, and exposing lightweight read-only state.
 class GameViewModel {
 public:
-    /// Attempt to locate and load the default level file by probing several folders.
+    /// Load the first level of the campaign. The shipped levels are built into the program
+    /// (see model/include/embedded_levels.hpp), so this reads and parses no file. A level file
+    /// of the same name in mods/levels/ under the working directory overrides the built-in one.
     bool loadDefaultLevel() {
-        static const std::array<std::string, 2> relativeCandidates = {
-            "levels/l1.json",
-            "model/levels/l1.json"
-        };
-
-        auto tryLoadFromBase = [&](const std::filesystem::path& base) {
-            for (const auto& rel : relativeCandidates) {
-                std::filesystem::path candidate = base / rel;
-                if (std::filesystem::exists(candidate)) {
-                    return loadLevel(candidate.string());
-                }
-            }
-            return false;
-        };
+        static const std::string defaultLevel = "l1.json";
 
-        std::filesystem::path current = std::filesystem::current_path();
-        while (true) {
-            if (tryLoadFromBase(current)) {
-                return true;
-            }
-            if (!current.has_parent_path()) {
-                break;
-            }
-            auto parent = current.parent_path();
-            if (parent == current) {
-                break;
-            }
-            current = parent;
+        std::error_code error;
+        std::filesystem::path modded = std::filesystem::path("mods") / "levels" / defaultLevel;
+        if (std::filesystem::exists(modded, error)) {
+            return loadLevel(modded.string());
         }
 
-        std::filesystem::path headerDir = std::filesystem::path(__FILE__).parent_path();
-        std::filesystem::path projectRoot = headerDir.parent_path();
-        if (tryLoadFromBase(projectRoot)) {
-            return true;
+        Level level;
+        if (loadEmbeddedLevel(defaultLevel, level)) {
+            return setLevel(std::move(level), "model/levels/" + defaultLevel);
         }
-
-        return false;
+        return findLevelOnDisk(defaultLevel);
     }
 
     /// Load the level located at 'path' and construct the underlying GamePlay instance.
     bool loadLevel(const std::string& path) {
+        Level level;
         try {
-            level_ = LevelLoader::loadLevel(path);
-            gameplay_ = std::make_unique<GamePlay>(level_);
-            winState_ = gameplay_->getCurrState().is_win;
-            return true;
+            level = LevelLoader::loadLevel(path);
         } catch (const std::exception& ex) {
             std::cerr << "Error loading level " << path << ": " << ex.what() << std::endl;
             gameplay_.reset();
             return false;
         }
+        return setLevel(std::move(level), path);
+    }
+
+    /// Path of the loaded level file, as passed to loadLevel().
+    const std::string& levelPath() const {
+        return levelPath_;
+    }
+
+    /// Hash of the level's initial state.
+    uint64_t startHash() const {
+        return startHash_;
     }
 
     bool hasGame() const {
@@ -81,31 +76,186 @@ public:
         if (!gameplay_) {
             return;
         }
+        // keep the state before the move in a scratch buffer (assigning reuses its storage) and
+        // swap it in only once the move displaced something, so that a blocked move leaves the
+        // states of an earlier snapshot() untouched
+        scratchState_ = gameplay_->getCurrState();
         gameplay_->operate(input);
         gameplay_->updateState();
+        if (gameplay_->getMoveEvents().empty()) {
+            // blocked: the state is unchanged, so its version is too
+            return;
+        }
+        std::swap(previousState_, scratchState_);
         winState_ = gameplay_->getCurrState().is_win;
+        stateChanged();
+        previousVersion_ = stateVersion_;
     }
 
-    void update() {
+    /// Undo the latest move; the journal stores only deltas, so this is constant time per move.
+    bool undo() {
+        if (!gameplay_ || !gameplay_->undo()) {
+            return false;
+        }
+        winState_ = gameplay_->getCurrState().is_win;
+        stateChanged();
+        return true;
+    }
+
+    /// Re-apply the latest undone move.
+    bool redo() {
+        if (!gameplay_ || !gameplay_->redo()) {
+            return false;
+        }
+        winState_ = gameplay_->getCurrState().is_win;
+        stateChanged();
+        return true;
+    }
+
+    /// Undo up to 'moves' moves (all of them restarts the level); returns how many were undone.
+    int rewind(int moves) {
+        if (!gameplay_) {
+            return 0;
+        }
+        int undone = gameplay_->rewind(moves);
+        winState_ = gameplay_->getCurrState().is_win;
+        if (undone > 0) {
+            stateChanged();
+        }
+        return undone;
+    }
+
+    /// What 'input' would do from the current state, without changing it. 'events' is a
+    /// caller-owned scratch buffer (reused across calls); returns false if the move is blocked.
+    bool previewMove(Input input, std::vector<MoveEvent>& events) const {
+        if (!gameplay_) {
+            events.clear();
+            return false;
+        }
+        return gameplay_->previewMove(input, events);
+    }
+
+    /// Incremented whenever the current state changes, so callers can cache derived data.
+    uint64_t stateVersion() const {
+        return stateVersion_;
+    }
+
+    /// Turn hints on or off. The worker thread starts on first use and then solves every new state while enabled.
+    void setHintsEnabled(bool enabled) {
+        hintsEnabled_ = enabled;
+        if (enabled && !hints_) {
+            hints_ = std::make_unique<HintService>();
+            if (gameplay_) {
+                hints_->setLevel(level_);
+            }
+        }
+        if (enabled && gameplay_) {
+            hints_->request(gameplay_->getCurrState(), stateVersion_);
+        }
+    }
+
+    bool hintsEnabled() const {
+        return hintsEnabled_;
+    }
+
+    /// Hint for the current state, polled without blocking (HINT_PENDING until the search is done).
+    HintService::Hint hint() const {
+        if (!hints_ || !hintsEnabled_) {
+            return HintService::Hint{};
+        }
+        return hints_->poll(stateVersion_);
+    }
+
+    int moveCount() const {
+        return gameplay_ ? gameplay_->getMoveCount() : 0;
+    }
+
+    /// Copy the session (level, state and undo journal) into 'session', reusing its storage;
+    /// the camera yaw is left to the caller. Cheap enough to do every move: no file I/O.
+    void saveSession(SavedSession& session) const {
         if (!gameplay_) {
-            winState_ = false;
             return;
         }
+        session.level = levelPath_;
+        session.level_id = level_.id;
+        session.start_hash = startHash_;
+        gameplay_->saveSession(session.game);
+    }
+
+    /// Resume a saved session, loading its level first unless it is the one being played.
+    /// Nothing changes if the level cannot be loaded or has changed since the session was saved.
+    bool resumeSession(const SavedSession& session) {
+        try {
+            if (gameplay_ && session.level == levelPath_) {
+                if (level_.id != session.level_id || startHash_ != session.start_hash) {
+                    throw std::runtime_error("the level has changed since it was saved");
+                }
+                gameplay_->restoreSession(session.game);
+            } else {
+                Level level = loadSessionLevel(session.level);
+                auto game = std::make_unique<GamePlay>(level);
+                if (level.id != session.level_id || game->getCurrState().hash != session.start_hash) {
+                    throw std::runtime_error("the level has changed since it was saved");
+                }
+                game->restoreSession(session.game);
+                level_ = std::move(level);
+                levelPath_ = session.level;
+                startHash_ = session.start_hash;
+                gameplay_ = std::move(game);
+                if (hints_) {
+                    hints_->setLevel(level_);
+                }
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "Cannot resume saved game of " << session.level << ": " << ex.what() << std::endl;
+            return false;
+        }
         winState_ = gameplay_->getCurrState().is_win;
+        stateChanged();
+        return true;
     }
 
-    GameState getState() const {
+    void update() {
         if (!gameplay_) {
-            return GameState{};
+            winState_ = false;
+            return;
         }
-        return gameplay_->getCurrState();
+        winState_ = gameplay_->getCurrState().is_win;
+    }
+
+    const GameState& getState() const {
+        static const GameState none{};
+        return gameplay_ ? gameplay_->getCurrState() : none;
+    }
+
+    const GameState& getNextState() const {
+        static const GameState none{};
+        return gameplay_ ? gameplay_->getNextState() : none;
     }
 
-    GameState getNextState() const {
+    /// Read-only view of the game state at one stateVersion(), for the renderer.
+    struct StateSnapshot {
+        uint64_t version = 0;                  // stateVersion() the view belongs to
+        const GameState* current = nullptr;    // Current state; nullptr without a game
+        const GameState* previous = nullptr;   // State before the latest move, to animate it from;
+                                               // the current state if the latest change was not a move
+    };
+
+    /// The current state without copying it. The states pointed to stay valid and unchanged while
+    /// stateVersion() equals the snapshot's version, so a renderer only needs a new snapshot when
+    /// the version changes.
+    StateSnapshot snapshot() const {
         if (!gameplay_) {
-            return GameState{};
+            return StateSnapshot{stateVersion_, nullptr, nullptr};
         }
-        return gameplay_->getNextState();
+        const GameState* current = &gameplay_->getCurrState();
+        return StateSnapshot{stateVersion_, current, previousVersion_ == stateVersion_ ? &previousState_ : current};
+    }
+
+    /// Entity displacements of the latest move, used to animate only what moved.
+    const std::vector<MoveEvent>& getMoveEvents() const {
+        static const std::vector<MoveEvent> none;
+        return gameplay_ ? gameplay_->getMoveEvents() : none;
     }
 
     const Level* getLevel() const {
@@ -116,10 +266,110 @@ public:
         return winState_;
     }
 
+    /// Whether the level can no longer be won (a box stuck on a dead square or frozen off target).
+    bool isDeadlocked() const {
+        return gameplay_ ? gameplay_->getCurrState().is_deadlocked : false;
+    }
+
+    /// Number of box targets still uncovered (cheap progress metric maintained by GamePlay).
+    int targetsRemaining() const {
+        return gameplay_ ? gameplay_->getCurrState().targets_remaining : 0;
+    }
+
 private:
+    /// Start playing 'level', read from 'path'.
+    bool setLevel(Level level, const std::string& path) {
+        try {
+            level_ = std::move(level);
+            levelPath_ = path;
+            gameplay_ = std::make_unique<GamePlay>(level_);
+            startHash_ = gameplay_->getCurrState().hash;
+            winState_ = gameplay_->getCurrState().is_win;
+            if (hints_) {
+                hints_->setLevel(level_);
+            }
+            stateChanged();
+            return true;
+        } catch (const std::exception& ex) {
+            std::cerr << "Error loading level " << path << ": " << ex.what() << std::endl;
+            gameplay_.reset();
+            return false;
+        }
+    }
+
+    /// Level of a saved session: its file, else the built-in level of the same name.
+    static Level loadSessionLevel(const std::string& path) {
+        try {
+            return LevelLoader::loadLevel(path);
+        } catch (const std::exception&) {
+            Level level;
+            if (loadEmbeddedLevel(std::filesystem::path(path).filename().string(), level)) {
+                return level;
+            }
+            throw;
+        }
+    }
+
+    /// Find a level file by probing the working directory, its parents and the source tree;
+    /// used only when the program was built without the level embedded.
+    bool findLevelOnDisk(const std::string& name) {
+        const std::array<std::string, 2> relativeCandidates = {
+            "levels/" + name,
+            "model/levels/" + name
+        };
+
+        auto tryLoadFromBase = [&](const std::filesystem::path& base) {
+            for (const auto& rel : relativeCandidates) {
+                std::filesystem::path candidate = base / rel;
+                if (std::filesystem::exists(candidate)) {
+                    return loadLevel(candidate.string());
+                }
+            }
+            return false;
+        };
+
+        std::filesystem::path current = std::filesystem::current_path();
+        while (true) {
+            if (tryLoadFromBase(current)) {
+                return true;
+            }
+            if (!current.has_parent_path()) {
+                break;
+            }
+            auto parent = current.parent_path();
+            if (parent == current) {
+                break;
+            }
+            current = parent;
+        }
+
+        std::filesystem::path headerDir = std::filesystem::path(__FILE__).parent_path();
+        std::filesystem::path projectRoot = headerDir.parent_path();
+        if (tryLoadFromBase(projectRoot)) {
+            return true;
+        }
+
+        return false;
+    }
+
+    void stateChanged() {
+        stateVersion_++;
+        if (hintsEnabled_ && gameplay_) {
+            hints_->request(gameplay_->getCurrState(), stateVersion_);
+        }
+    }
+
     Level level_{};
+    std::string levelPath_;
+    uint64_t startHash_ = 0;        // Hash of the level's initial state, stored in saves
     std::unique_ptr<GamePlay> gameplay_;
     bool winState_ = false;
+    uint64_t stateVersion_ = 0;
+    GameState previousState_{};     // State before the move that produced previousVersion_
+    uint64_t previousVersion_ = 0;
+    GameState scratchState_{};      // State before the move being handled, becomes previousState_ if it moves
+    bool hintsEnabled_ = false;
+    std::unique_ptr<HintService> hints_;
 };
 
 #endif // GAME_VIEW_MODEL_HPP
@@ -0,0 +1,161 @@
+﻿#ifndef HINT_SERVICE_HPP
+#define HINT_SERVICE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "model/include/gameplay.hpp"
+#include "model/include/level_loader.hpp"
+#include "model/include/solver.hpp"
+
+/// Background hint engine: solves the current position on a worker thread and publishes the
+/// first move of an optimal solution. Every request cancels the search in progress, so the
+/// worker always chases the latest state. The render thread only ever touches an atomic slot
+/// and a briefly held job mutex (never held during a search), so it cannot block on the solver.
+class HintService {
+public:
+    /// Outcome published for one requested state.
+    enum Status : uint8_t {
+        HINT_PENDING,      ///< Still searching (or the search gave up on its budget)
+        HINT_MOVE,         ///< 'move' is the first step of an optimal solution
+        HINT_UNSOLVABLE,   ///< The position cannot be won any more
+        HINT_SOLVED        ///< The position is already won
+    };
+
+    struct Hint {
+        Status status = HINT_PENDING;
+        Input move = UP;
+    };
+
+    /// Search limits; the defaults keep the service cheap enough to leave on in release builds.
+    struct Budget {
+        size_t tableBytes = size_t(64) << 20;   ///< Visited-state table memory
+        size_t maxStates = 2000000;             ///< States stored before giving up on a position
+        int threads = 1;                        ///< Solver threads (one leaves the other cores to the game)
+    };
+
+    HintService() : HintService(Budget{}) {}
+
+    explicit HintService(Budget budget) : budget_(budget) {
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~HintService() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            cancel_.store(true, std::memory_order_relaxed);
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+
+    HintService(const HintService&) = delete;
+    HintService& operator=(const HintService&) = delete;
+
+    /// Use this level for the following requests (copied, the caller may replace its own).
+    void setLevel(const Level& level) {
+        auto copy = std::make_shared<const Level>(level);
+        std::lock_guard<std::mutex> lock(mutex_);
+        level_ = std::move(copy);
+        job_.reset();
+        cancel_.store(true, std::memory_order_relaxed);
+    }
+
+    /// Ask for a hint for 'state', tagged with the caller's state version; cancels the current search.
+    void request(const GameState& state, uint64_t version) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!level_) {
+                return;
+            }
+            job_ = Job{level_, state, version};
+            cancel_.store(true, std::memory_order_relaxed);
+        }
+        wake_.notify_one();
+    }
+
+    /// Latest published hint if it belongs to 'version' (lock-free; safe to call every frame).
+    Hint poll(uint64_t version) const {
+        uint64_t slot = slot_.load(std::memory_order_acquire);
+        Hint hint;
+        if ((slot >> 16) == (version & VERSION_MASK)) {
+            hint.status = static_cast<Status>(slot & 0xFF);
+            hint.move = static_cast<Input>((slot >> 8) & 0xFF);
+        }
+        return hint;
+    }
+
+private:
+    static constexpr uint64_t VERSION_MASK = (uint64_t(1) << 48) - 1;
+
+    struct Job {
+        std::shared_ptr<const Level> level;
+        GameState state;
+        uint64_t version;
+    };
+
+    void run() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || job_.has_value(); });
+                if (stopping_) {
+                    return;
+                }
+                job = std::move(*job_);
+                job_.reset();
+                cancel_.store(false, std::memory_order_relaxed);
+            }
+
+            SolverOptions options;
+            options.algorithm = SOLVER_ASTAR;
+            options.threads = budget_.threads;
+            options.table_bytes = budget_.tableBytes;
+            options.max_states = budget_.maxStates;
+            options.start = &job.state;
+            options.cancel = &cancel_;
+
+            Hint hint;
+            try {
+                SolveResult result = solve(*job.level, options);
+                if (result.solved) {
+                    hint.status = result.moves.empty() ? HINT_SOLVED : HINT_MOVE;
+                    hint.move = result.moves.empty() ? UP : result.moves.front();
+                } else if (result.exhausted) {
+                    hint.status = HINT_UNSOLVABLE;
+                } else {
+                    continue;   // cancelled or over budget: nothing to publish
+                }
+            } catch (const std::exception&) {
+                continue;       // e.g. a level too large to pack; hints simply stay pending
+            }
+            publish(job.version, hint);
+        }
+    }
+
+    void publish(uint64_t version, Hint hint) {
+        uint64_t slot = ((version & VERSION_MASK) << 16)
+            | (static_cast<uint64_t>(hint.move) << 8)
+            | static_cast<uint64_t>(hint.status);
+        slot_.store(slot, std::memory_order_release);
+    }
+
+    Budget budget_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::shared_ptr<const Level> level_;
+    std::optional<Job> job_;
+    bool stopping_ = false;
+    std::atomic<bool> cancel_{false};
+    std::atomic<uint64_t> slot_{~uint64_t(0)};
+    std::thread worker_;
+};
+
+#endif // HINT_SERVICE_HPP
@@ -0,0 +1,154 @@
+﻿#ifndef SAVE_SERVICE_HPP
+#define SAVE_SERVICE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "model/include/session.hpp"
+
+/// Background writer of save files (autosave and quick-save slots). Each save path has a
+/// double-buffered slot: submit() fills the slot's buffer under a briefly held mutex (reusing
+/// its storage), and the worker swaps that buffer with its own before writing it outside the
+/// lock. The game loop therefore never waits on file I/O; a save submitted while the previous
+/// one is still being written simply replaces any save of the same path that has not started.
+class SaveService {
+public:
+    SaveService() {
+        worker_ = std::thread([this] { run(); });
+    }
+
+    /// Writes every submitted save before returning.
+    ~SaveService() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+
+    SaveService(const SaveService&) = delete;
+    SaveService& operator=(const SaveService&) = delete;
+
+    /// Queue a save to 'path'. 'fill' is called at once with the slot's SavedSession to copy the
+    /// session into; it runs under the service's mutex, so it must be quick and must not call back.
+    template <typename F>
+    void submit(const std::string& path, F&& fill) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Slot* slot = nullptr;
+            for (auto& candidate : slots_) {
+                if (candidate.path == path) {
+                    slot = &candidate;
+                    break;
+                }
+            }
+            if (!slot) {
+                slots_.push_back(Slot{path, SavedSession{}, false});
+                slot = &slots_.back();
+            }
+            fill(slot->session);
+            slot->pending = true;
+        }
+        wake_.notify_one();
+    }
+
+    /// Block until every submitted save has been written (e.g. before loading one of them).
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return !writing_ && !hasPending(); });
+    }
+
+    /// Number of saves written so far.
+    uint64_t written() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return written_;
+    }
+
+    /// Error of the latest failed save, empty if none failed.
+    std::string lastError() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lastError_;
+    }
+
+private:
+    struct Slot {
+        std::string path;
+        SavedSession session;   ///< Front buffer, filled by submit()
+        bool pending;           ///< Whether 'session' holds a save not yet handed to the worker
+    };
+
+    bool hasPending() const {
+        for (const auto& slot : slots_) {
+            if (slot.pending) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run() {
+        SavedSession buffer;    // Back buffer: the save being written
+        std::string path;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || hasPending(); });
+                if (!hasPending()) {
+                    return;     // stopping, and everything has been written
+                }
+                for (auto& slot : slots_) {
+                    if (slot.pending) {
+                        std::swap(buffer, slot.session);
+                        path = slot.path;
+                        slot.pending = false;
+                        break;
+                    }
+                }
+                writing_ = true;
+            }
+
+            std::string error;
+            try {
+                std::error_code ignored;
+                std::filesystem::path parent = std::filesystem::path(path).parent_path();
+                if (!parent.empty()) {
+                    std::filesystem::create_directories(parent, ignored);
+                }
+                SessionFile::save(path, buffer);
+            } catch (const std::exception& ex) {
+                error = ex.what();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                writing_ = false;
+                if (error.empty()) {
+                    written_++;
+                } else {
+                    lastError_ = std::move(error);
+                }
+            }
+            idle_.notify_all();
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<Slot> slots_;
+    bool writing_ = false;
+    bool stopping_ = false;
+    uint64_t written_ = 0;
+    std::string lastError_;
+    std::thread worker_;
+};
+
+#endif // SAVE_SERVICE_HPP